@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+"""Compile-time benchmark of the encoder generation (makeEncoder).
+
+For every N given on the command line the library from source/ is copied
+into a temporary directory and extended to N encodings: encoding_code<K>
+for every K from the current encoding_count up to N-1 is added to the
+encodings list. Each new encoding gets lossless base encoders to and from
+the previous one, registered in base_encoders, so the encodings form a
+chain hanging off the last real encoding. Two translation units are then
+compiled with -fsyntax-only:
+
+  one pair   makeEncoder<UTF8, UTF16>, pays for the path tables once
+  all pairs  makeEncoder<T, U, false> for every T != U
+
+What is measured:
+
+  instantiations  class template instantiations in namespace encoding,
+                  counted from the GCC class hierarchy dump (-fdump-lang-class)
+  per pair        (all pairs - one pair) / (pair count - 1), the cost of
+                  adding one more generated encoder
+  seconds         wall time of the compiler
+
+The number of pairs is N*(N-1), so the total for all pairs grows with N^2
+even when the cost per pair stays the same. The path tables are paid once
+per translation unit, which is the one pair column. They instantiate the
+encoders registered in base_encoders, so this fixed cost grows with the
+number of base encoders B (2 per added encoding here), not with N^2. The
+constexpr evaluation of the tables is not an instantiation but still takes
+compile time, which the seconds of the one pair column include: the BFS
+walks N*(N+B) steps and the two next hop tables have N*N cells each. The
+per pair columns are the ones to watch when encodings are added: each pair
+instantiates only its own makeEncoder and CombinedEncoder, and reuses the
+rest of the path from the pair of its next hop.
+
+Usage: benchmark/compile_time.py [N ...] [--compiler g++]
+"""
+
+import argparse
+import os
+import re
+import shutil
+import subprocess
+import tempfile
+import time
+
+SOURCE = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'source')
+
+
+def encoding_count():
+    with open(os.path.join(SOURCE, 'Encoding.h')) as f:
+        encodings = re.search(r'using encodings = EncodingList<([^>]*)>;', f.read()).group(1)
+    return len(encodings.split(','))
+
+
+def base_encoder_count():
+    with open(os.path.join(SOURCE, 'Encoding.h')) as f:
+        text = f.read()
+    begin = text.index('using base_encoders = BaseEncoderList<')
+    return text.count('EncodingPair<', begin, text.index('>;', begin))
+
+
+def base_encoder(source, target):
+    return ('\ttemplate<>\n\tclass Encoder<encoding_code<%d>, encoding_code<%d>>\n\t{\n\tpublic:\n'
+            '\t\tusing input_type = std::string_view;\n\t\tusing output_type = std::string;\n\n'
+            '\t\tusing is_base_encoder = std::true_type;\n\t\tusing is_lossless = std::true_type;\n\n'
+            '\t\toutput_type convert(input_type text) const { return output_type{ text }; }\n\t};\n\n') % (source, target)
+
+
+def extend_library(directory, count, real_count):
+    path = os.path.join(directory, 'Encoding.h')
+    with open(path) as f:
+        text = f.read()
+    extra = ''.join(', encoding_code<%d>' % code for code in range(real_count, count))
+    text = re.sub(r'(using encodings = EncodingList<[^>]*)>;', lambda match: match.group(1) + extra + '>;', text)
+    registered = ''.join(', EncodingPair<encoding_code<%d>, encoding_code<%d>>, EncodingPair<encoding_code<%d>, encoding_code<%d>>'
+                         % (code - 1, code, code, code - 1) for code in range(real_count, count))
+    end = text.index('>;', text.index('using base_encoders = BaseEncoderList<'))
+    text = text[:end] + registered + text[end:]
+    with open(path, 'w') as f:
+        f.write(text)
+
+    path = os.path.join(directory, 'BaseEncoders.h')
+    with open(path) as f:
+        text = f.read()
+    encoders = ''.join(base_encoder(code - 1, code) + base_encoder(code, code - 1) for code in range(real_count, count))
+    end = text.rindex('}\n\n#endif')
+    with open(path, 'w') as f:
+        f.write(text[:end] + encoders + text[end:])
+
+
+def translation_unit(pairs):
+    lines = ['#include "Encoder.h"', '', 'using namespace encoding;', '']
+    lines += ['makeEncoder<encoding_code<%d>, encoding_code<%d>, false> encoder_%d_%d{};' % (t, u, t, u) for t, u in pairs]
+    return '\n'.join(lines + ['', 'int main() {}', ''])
+
+
+def compile_unit(compiler, directory, name, pairs):
+    source = os.path.join(directory, name + '.cpp')
+    with open(source, 'w') as f:
+        f.write(translation_unit(pairs))
+
+    begin = time.perf_counter()
+    subprocess.run([compiler, '-std=c++17', '-fsyntax-only', '-fdump-lang-class', '-I', directory, source],
+                   cwd=directory, check=True)
+    seconds = time.perf_counter() - begin
+
+    instantiations = 0
+    for dump in os.listdir(directory):
+        if dump.endswith('.class') and (name + '.cpp.') in dump:
+            with open(os.path.join(directory, dump)) as f:
+                instantiations += sum(1 for line in f if line.startswith('Class encoding::') and '<' in line)
+            os.remove(os.path.join(directory, dump))
+
+    return instantiations, seconds
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Compile-time cost of makeEncoder for N encodings')
+    parser.add_argument('counts', nargs='*', type=int, default=[8, 16, 24, 32])
+    parser.add_argument('--compiler', default='g++')
+    arguments = parser.parse_args()
+
+    real_count = encoding_count()
+    real_base_count = base_encoder_count()
+    print('%4s %4s %8s | %15s %8s | %15s %8s | %9s %11s' % ('N', 'B', 'pairs', 'one pair inst', 'seconds', 'all pairs inst', 'seconds', 'inst/pair', 'ms/pair'))
+
+    for count in arguments.counts:
+        if count < real_count:
+            raise SystemExit('N must be at least %d, the number of real encodings' % real_count)
+
+        with tempfile.TemporaryDirectory() as directory:
+            shutil.copytree(SOURCE, directory, dirs_exist_ok=True)
+            extend_library(directory, count, real_count)
+
+            pairs = [(t, u) for t in range(count) for u in range(count) if t != u]
+            one = compile_unit(arguments.compiler, directory, 'one', [(0, 1)])
+            every = compile_unit(arguments.compiler, directory, 'all', pairs)
+
+            added = len(pairs) - 1
+            print('%4d %4d %8d | %15d %8.2f | %15d %8.2f | %9.1f %11.2f' % (
+                count, real_base_count + 2 * (count - real_count), len(pairs), one[0], one[1], every[0], every[1],
+                (every[0] - one[0]) / added, 1000 * (every[1] - one[1]) / added))
+
+
+if __name__ == '__main__':
+    main()
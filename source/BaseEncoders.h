@@ -3,8 +3,10 @@
 
 #include "Encoding.h"
 #include "Converters.h"
+#include "MaybeOwnedString.h"
 
 #include <string>
+#include <utility>
 
 namespace encoding
 {
@@ -13,7 +15,7 @@ namespace encoding
 	{
 	};
 
-	//The encoder have to have the default constructor
+	//The encoder have to have the default constructor and has to be registered in base_encoders (Encoding.h)
 	//The minimal encoder should contain the following elements
 	/*template<>
 	class Encoder<T, U>
@@ -27,8 +29,113 @@ namespace encoding
 
 		output_type convert(input_type) const;
 
+		void convert(input_type, output_type &) const; // Optional, overwrites the output reusing its capacity (a non const overload may also reuse buffers owned by the encoder)
+
+		using is_in_place = std::true_type; // Optional, together with the following overload
+		void convert(output_type && text) const; // Converts the owned input text in place, input and output have to be the same string type
+
+		bool isIdentity(input_type) const; // Optional, true if the conversion would return the text unchanged
+		MaybeOwnedString<...> convertOrBorrow(input_type) const; // Together with isIdentity, returns the text itself if it would be unchanged
+		using is_ascii_transparent = std::true_type; // Optional, ascii characters are converted to the same code units
+
 	};*/
 
+	namespace helpers
+	{
+		//T may be const, then only the const overload counts
+		template<typename T, typename = void>
+		struct hasOutputConvert : std::false_type {};
+
+		template<typename T>
+		struct hasOutputConvert<T, std::void_t<decltype(std::declval<T &>().convert(std::declval<typename T::input_type>(), std::declval<typename T::output_type &>()))>> : std::true_type {};
+
+		template<typename T, typename = void>
+		struct isInPlaceEncoder : std::false_type {};
+
+		template<typename T>
+		struct isInPlaceEncoder<T, std::void_t<typename T::is_in_place>> : T::is_in_place {};
+
+		template<typename T, typename = void>
+		struct hasIsIdentity : std::false_type {};
+
+		template<typename T>
+		struct hasIsIdentity<T, std::void_t<decltype(std::declval<const T &>().isIdentity(std::declval<typename T::input_type>()))>> : std::true_type {};
+
+		template<typename T, typename = void>
+		struct hasConvertOrBorrow : std::false_type {};
+
+		template<typename T>
+		struct hasConvertOrBorrow<T, std::void_t<decltype(std::declval<const T &>().convertOrBorrow(std::declval<typename T::input_type>()))>> : std::true_type {};
+
+		template<typename T, typename = void>
+		struct isAsciiTransparent : std::false_type {};
+
+		template<typename T>
+		struct isAsciiTransparent<T, std::void_t<typename T::is_ascii_transparent>> : T::is_ascii_transparent {};
+
+		//The string which owns the text viewed by input_type
+		template<typename T>
+		using owned_input_t = std::basic_string<typename std::remove_cv_t<std::remove_reference_t<typename T::input_type>>::value_type>;
+
+		//Converts into the output, encoders without the output overload fall back to the assignment
+		//A non const encoder may reuse the scratch buffers it owns
+		template<typename T>
+		inline void convertInto(T & encoder, typename T::input_type text, typename T::output_type & output)
+		{
+			if constexpr (hasOutputConvert<T>::value)
+				encoder.convert(text, output);
+			else
+				output = encoder.convert(text);
+		}
+
+		template<typename T>
+		using borrowed_output_t = MaybeOwnedString<typename T::output_type::value_type>;
+
+		//convertOrBorrow of the base encoders with isIdentity
+		template<typename T>
+		inline borrowed_output_t<T> borrowIfIdentity(const T & encoder, typename T::input_type text)
+		{
+			if (encoder.isIdentity(text))
+				return typename borrowed_output_t<T>::view_type{ text };
+			else
+				return encoder.convert(text);
+		}
+
+		//Returns the text itself if the encoder says the conversion would not change it, works with every encoder
+		template<typename T>
+		inline borrowed_output_t<T> convertOrBorrow(const T & encoder, typename T::input_type text)
+		{
+			if constexpr (hasConvertOrBorrow<T>::value)
+				return encoder.convertOrBorrow(text);
+			else if constexpr (hasIsIdentity<T>::value)
+				return borrowIfIdentity(encoder, text);
+			else
+				return encoder.convert(text);
+		}
+
+		//Converts the text, which the caller gives away
+		//In-place encoders reuse its buffer, combined encoders pass it on to their first stage
+		template<typename T, typename Text>
+		inline typename T::output_type consume(const T & encoder, Text && text)
+		{
+			constexpr bool owned = !std::is_lvalue_reference_v<Text> && std::is_same_v<std::decay_t<Text>, owned_input_t<T>>;
+
+			if constexpr (owned && isInPlaceEncoder<T>::value && std::is_same_v<owned_input_t<T>, typename T::output_type>)
+			{
+				encoder.convert(std::move(text));
+				return std::move(text);
+			}
+			else if constexpr (owned && !T::is_base_encoder::value)
+			{
+				return encoder.convert(std::move(text));
+			}
+			else
+			{
+				return encoder.convert(static_cast<typename T::input_type>(text));
+			}
+		}
+	}
+
 
 	template<>
 	class Encoder<UTF8, UTF16>
@@ -39,11 +146,17 @@ namespace encoding
 
 		using is_base_encoder = std::true_type;
 		using is_lossless = std::true_type;
+		using is_ascii_transparent = std::true_type;
 
 		output_type convert(input_type text) const
 		{
 			return converters::convertUTF8_UTF16(text);
 		}
+
+		void convert(input_type text, output_type & output) const
+		{
+			converters::convertUTF8_UTF16(text, output);
+		}
 	};
 
 	template<>
@@ -55,12 +168,18 @@ namespace encoding
 
 		using is_base_encoder = std::true_type;
 		using is_lossless = std::true_type;
+		using is_ascii_transparent = std::true_type;
 
 		output_type convert(input_type text) const
 		{
 			return converters::convertUTF16_UTF8(text);
 		}
 
+		void convert(input_type text, output_type & output) const
+		{
+			converters::convertUTF16_UTF8(text, output);
+		}
+
 	};
 
 	template<>
@@ -78,6 +197,23 @@ namespace encoding
 			return converters::convertURLEncode_UTF8(text);
 		}
 
+		bool isIdentity(input_type text) const noexcept
+		{
+			return converters::isIdentityURLEncode_UTF8(text);
+		}
+
+		MaybeOwnedString<char> convertOrBorrow(input_type text) const
+		{
+			return helpers::borrowIfIdentity(*this, text);
+		}
+
+		void convert(input_type text, output_type & output) const
+		{
+			converters::convertURLEncode_UTF8(text, output);
+		}
+
+		using is_in_place = std::true_type;
+
 		void convert(std::string && text) const
 		{
 			converters::convertURLEncode_UTF8(std::move(text));
@@ -99,12 +235,104 @@ namespace encoding
 			return converters::convertUTF8_URLEncode(text);
 		}
 
+		bool isIdentity(input_type text) const noexcept
+		{
+			return converters::isIdentityUTF8_URLEncode(text);
+		}
+
+		MaybeOwnedString<char> convertOrBorrow(input_type text) const
+		{
+			return helpers::borrowIfIdentity(*this, text);
+		}
+
+		void convert(input_type text, output_type & output) const
+		{
+			converters::convertUTF8_URLEncode(text, output);
+		}
+
+		using is_in_place = std::true_type;
+
 		void convert(std::string && text) const
 		{
 			converters::convertUTF8_URLEncode(std::move(text));
 		}
 	};
 
+	template<>
+	class Encoder<UTF8, JSONString>
+	{
+	public:
+		using input_type = std::string_view;
+		using output_type = std::string;
+
+		using is_base_encoder = std::true_type;
+		using is_lossless = std::true_type;
+
+		Encoder() = default;
+		explicit Encoder(bool escape_non_ascii) : escape_non_ascii{ escape_non_ascii } {} // Non ascii characters as \uXXXX, the output is ascii
+
+		output_type convert(input_type text) const
+		{
+			return converters::convertUTF8_JSONString(text, escape_non_ascii);
+		}
+
+		bool isIdentity(input_type text) const noexcept
+		{
+			return converters::isIdentityUTF8_JSONString(text, escape_non_ascii);
+		}
+
+		MaybeOwnedString<char> convertOrBorrow(input_type text) const
+		{
+			return helpers::borrowIfIdentity(*this, text);
+		}
+
+		void convert(input_type text, output_type & output) const
+		{
+			converters::convertUTF8_JSONString(text, output, escape_non_ascii);
+		}
+
+	private:
+		bool escape_non_ascii = false;
+	};
+
+	template<>
+	class Encoder<JSONString, UTF8>
+	{
+	public:
+		using input_type = std::string_view;
+		using output_type = std::string;
+
+		using is_base_encoder = std::true_type;
+		using is_lossless = std::true_type;
+
+		output_type convert(input_type text) const
+		{
+			return converters::convertJSONString_UTF8(text);
+		}
+
+		bool isIdentity(input_type text) const noexcept
+		{
+			return converters::isIdentityJSONString_UTF8(text);
+		}
+
+		MaybeOwnedString<char> convertOrBorrow(input_type text) const
+		{
+			return helpers::borrowIfIdentity(*this, text);
+		}
+
+		void convert(input_type text, output_type & output) const
+		{
+			converters::convertJSONString_UTF8(text, output);
+		}
+
+		using is_in_place = std::true_type;
+
+		void convert(std::string && text) const
+		{
+			converters::convertJSONString_UTF8(std::move(text));
+		}
+	};
+
 	template<>
 	class Encoder<UTF16, ASCII>
 	{
@@ -114,11 +342,17 @@ namespace encoding
 
 		using is_base_encoder = std::true_type;
 		using is_lossless = std::false_type;
+		using is_ascii_transparent = std::true_type;
 
 		output_type convert(input_type text) const
 		{
 			return converters::convertUTF16_ASCII(text);
 		}
+
+		void convert(input_type text, output_type & output) const
+		{
+			converters::convertUTF16_ASCII(text, output);
+		}
 	};
 
 	template<>
@@ -130,11 +364,17 @@ namespace encoding
 
 		using is_base_encoder = std::true_type;
 		using is_lossless = std::true_type;
+		using is_ascii_transparent = std::true_type;
 
 		output_type convert(input_type text) const
 		{
 			return converters::convertASCII_UTF16(text);
 		}
+
+		void convert(input_type text, output_type & output) const
+		{
+			converters::convertASCII_UTF16(text, output);
+		}
 	};
 }
 
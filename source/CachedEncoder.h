@@ -0,0 +1,199 @@
+#ifndef CACHED_ENCODER_H
+#define CACHED_ENCODER_H
+
+#include "Encoder.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace encoding
+{
+	//Encoder E which remembers the results of recent conversions of short texts (e.g. CachedEncoder<makeEncoder<UTF8, URLEncode>>)
+	//The cache is split into shards by the hash of the text, a hit takes only the shared lock of one shard
+	//Entries are evicted with the CLOCK algorithm, texts longer than max_entry_size are converted without the cache
+	//A hit writes nothing shared but the shared lock: hits are counted in per thread stripes and the reference bit is set only once
+	template<typename E>
+	class CachedEncoder
+	{
+	public:
+		using input_type = typename E::input_type;
+		using output_type = typename E::output_type;
+
+		using is_base_encoder = typename E::is_base_encoder;
+		using is_lossless = typename E::is_lossless;
+
+		struct Statistics
+		{
+			std::uint64_t hits;
+			std::uint64_t misses;
+			std::uint64_t evictions;
+			std::uint64_t uncached; // Texts longer than max_entry_size
+		};
+
+		//At most capacity entries are cached in total, a small cache uses fewer shards so that no shard is empty
+		explicit CachedEncoder(std::size_t capacity = 1024, std::size_t max_entry_size = 64) :
+			max_entry_size{ max_entry_size }, shard_count{ std::clamp<std::size_t>(capacity, 1, max_shard_count) },
+			shards{ std::make_unique<Shard[]>(shard_count) }
+		{
+			for (std::size_t i = 0; i < shard_count; i++)
+			{
+				shards[i].entries = std::vector<Entry>(capacity / shard_count + (i < capacity % shard_count ? 1 : 0));
+			}
+		}
+
+		output_type convert(input_type text) const
+		{
+			view_type key{ text };
+
+			if (key.size() > max_entry_size)
+			{
+				uncached.fetch_add(1, std::memory_order_relaxed);
+				return encoder.convert(text);
+			}
+
+			auto hash = std::hash<view_type>{}(key);
+			auto & shard = shards[hash % shard_count];
+
+			{
+				std::shared_lock<std::shared_mutex> lock{ shard.mutex };
+				if (auto it = shard.index.find(hash); it != shard.index.end())
+				{
+					if (auto & entry = shard.entries.at(it->second); entry.key == key)
+					{
+						if (!entry.referenced.load(std::memory_order_relaxed))
+						{
+							entry.referenced.store(true, std::memory_order_relaxed);
+						}
+
+						hits[hitStripe()].count.fetch_add(1, std::memory_order_relaxed);
+						return entry.value;
+					}
+				}
+			}
+
+			shard.misses.fetch_add(1, std::memory_order_relaxed);
+			auto converted = encoder.convert(text);
+
+			std::unique_lock<std::shared_mutex> lock{ shard.mutex };
+			if (!shard.entries.empty() && shard.index.find(hash) == shard.index.end()) // Texts with the same hash as a cached one are not cached
+			{
+				auto & entry = shard.entries.at(shard.nextVictim());
+				if (entry.used)
+				{
+					shard.index.erase(entry.hash);
+					shard.evictions.fetch_add(1, std::memory_order_relaxed);
+				}
+
+				entry.hash = hash;
+				entry.key.assign(key);
+				entry.value = converted;
+				entry.referenced.store(false, std::memory_order_relaxed);
+				entry.used = true;
+
+				shard.index.emplace(hash, static_cast<std::size_t>(&entry - shard.entries.data()));
+			}
+
+			return converted;
+		}
+
+		Statistics statistics() const noexcept
+		{
+			Statistics statistics{ 0, 0, 0, uncached.load(std::memory_order_relaxed) };
+
+			for (auto & stripe : hits)
+			{
+				statistics.hits += stripe.count.load(std::memory_order_relaxed);
+			}
+
+			for (std::size_t i = 0; i < shard_count; i++)
+			{
+				statistics.misses += shards[i].misses.load(std::memory_order_relaxed);
+				statistics.evictions += shards[i].evictions.load(std::memory_order_relaxed);
+			}
+
+			return statistics;
+		}
+
+		void clear()
+		{
+			for (std::size_t i = 0; i < shard_count; i++)
+			{
+				std::unique_lock<std::shared_mutex> lock{ shards[i].mutex };
+
+				shards[i].index.clear();
+				for (auto & entry : shards[i].entries)
+				{
+					entry.used = false;
+				}
+			}
+		}
+
+	private:
+		using view_type = std::basic_string_view<typename helpers::owned_input_t<E>::value_type>;
+
+		static constexpr std::size_t max_shard_count = 16;
+		static constexpr std::size_t hit_stripe_count = 16;
+
+		struct alignas(64) HitStripe
+		{
+			std::atomic<std::uint64_t> count{};
+		};
+
+		static std::size_t hitStripe() noexcept // Threads count their hits on different cache lines
+		{
+			static thread_local const std::size_t stripe = std::hash<std::thread::id>{}(std::this_thread::get_id()) % hit_stripe_count;
+			return stripe;
+		}
+
+		struct Entry
+		{
+			std::size_t hash = 0;
+			helpers::owned_input_t<E> key{};
+			output_type value{};
+			std::atomic<bool> referenced{ false };
+			bool used = false;
+		};
+
+		struct alignas(64) Shard
+		{
+			std::size_t nextVictim() noexcept // Skips and clears the entries used since the hand passed them
+			{
+				while (entries.at(hand).used && entries.at(hand).referenced.exchange(false, std::memory_order_relaxed))
+				{
+					hand = (hand + 1) % entries.size();
+				}
+
+				auto victim = hand;
+				hand = (hand + 1) % entries.size();
+				return victim;
+			}
+
+			mutable std::shared_mutex mutex{};
+			std::vector<Entry> entries{};
+			std::unordered_map<std::size_t, std::size_t> index{}; // hash -> entry
+			std::size_t hand = 0;
+
+			std::atomic<std::uint64_t> misses{};
+			std::atomic<std::uint64_t> evictions{};
+		};
+
+		E encoder{};
+		std::size_t max_entry_size;
+		std::size_t shard_count;
+		std::unique_ptr<Shard[]> shards;
+		mutable std::atomic<std::uint64_t> uncached{};
+		mutable std::array<HitStripe, hit_stripe_count> hits{};
+	};
+}
+
+#endif // !CACHED_ENCODER_H
\ No newline at end of file
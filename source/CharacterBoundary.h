@@ -0,0 +1,142 @@
+#ifndef CHARACTER_BOUNDARY_H
+#define CHARACTER_BOUNDARY_H
+
+#include "Encoding.h"
+
+#include <string_view>
+#include <charconv>
+
+namespace encoding
+{
+	template<typename T>
+	struct CharacterBoundary
+	{
+	};
+
+	//CharacterBoundary tells how many code units of the text belong to its first character,
+	//so the text can be split into pieces that every encoder converts independently
+	//The minimal specialization should contain the following elements
+	/*template<>
+	struct CharacterBoundary<T>
+	{
+		using input_type (e.g. std::string_view)
+
+		static std::size_t length(input_type text); // text is not empty, the result may be greater than text.size() if the character is truncated
+	};*/
+
+	namespace helpers
+	{
+		inline constexpr std::size_t characterLengthUTF8(unsigned char first_byte) noexcept
+		{
+			if (first_byte < 0x80)
+				return 1;
+			else if (first_byte < 0xE0)
+				return 2;
+			else if (first_byte < 0xF0)
+				return 3;
+			else if (first_byte < 0xF5)
+				return 4;
+			else
+				return 1; //Invalid, the encoder will report it
+		}
+	}
+
+	template<>
+	struct CharacterBoundary<UTF8>
+	{
+		using input_type = std::string_view;
+
+		static std::size_t length(input_type text) noexcept
+		{
+			return helpers::characterLengthUTF8(static_cast<unsigned char>(text.front()));
+		}
+	};
+
+	template<>
+	struct CharacterBoundary<UTF16>
+	{
+		using input_type = std::wstring_view;
+
+		static std::size_t length(input_type text) noexcept
+		{
+			return (text.front() >= 0xD800 && text.front() <= 0xDFFF) ? 2 : 1;
+		}
+	};
+
+	template<>
+	struct CharacterBoundary<ASCII>
+	{
+		using input_type = std::string_view;
+
+		static std::size_t length(input_type) noexcept
+		{
+			return 1;
+		}
+	};
+
+	template<>
+	struct CharacterBoundary<JSONString>
+	{
+		using input_type = std::string_view;
+
+		static std::size_t length(input_type text) noexcept
+		{
+			if (text.front() != '\\')
+			{
+				return helpers::characterLengthUTF8(static_cast<unsigned char>(text.front()));
+			}
+			else if (text.size() < 2 || text[1] != 'u')
+			{
+				return 2;
+			}
+			else if (text.size() < 6)
+			{
+				return 6;
+			}
+
+			//A high surrogate escape is followed by the low surrogate one
+			unsigned int unit;
+			if (auto[ptr, ec] = std::from_chars(text.data() + 2, text.data() + 6, unit, 16); ec == std::errc{} && ptr == text.data() + 6 && unit >= 0xD800 && unit <= 0xDBFF)
+			{
+				return 12;
+			}
+
+			return 6;
+		}
+	};
+
+	template<>
+	struct CharacterBoundary<URLEncode>
+	{
+		using input_type = std::string_view;
+
+		static std::size_t length(input_type text) noexcept
+		{
+			//URLEncode carries UTF8, so the whole escaped UTF8 character has to stay together
+			unsigned char first_byte = static_cast<unsigned char>(text.front());
+			if (text.front() == '%' && text.size() >= 3)
+			{
+				unsigned char character;
+				if (auto[ptr, ec] = std::from_chars(text.data() + 1, text.data() + 3, character, 16); ec == std::errc{} && ptr == text.data() + 3)
+				{
+					first_byte = character;
+				}
+			}
+
+			std::size_t lenght = 0;
+			for (std::size_t i = helpers::characterLengthUTF8(first_byte); i > 0; i--)
+			{
+				if (lenght >= text.size())
+				{
+					return text.size() + 1;
+				}
+
+				lenght += text.at(lenght) == '%' ? 3 : 1;
+			}
+
+			return lenght;
+		}
+	};
+}
+
+#endif // !CHARACTER_BOUNDARY_H
\ No newline at end of file
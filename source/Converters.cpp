@@ -1,16 +1,31 @@
 #include "Converters.h"
+#include "Swar.h"
+#include "UTF8Validator.h"
 
 #include <array>
 #include <charconv>
 #include <cctype>
+#include <cstring>
+#include <type_traits>
 
 namespace encoding
 {
 	namespace converters
 	{
+		constexpr char hex_digits[] = "0123456789abcdef";
+
 		std::string convertUTF16_ASCII(std::wstring_view text) // Every non ascii (0-127) character will be casted to 128
 		{
 			std::string converted{};
+			convertUTF16_ASCII(text, converted);
+			return converted;
+		}
+
+		void convertUTF16_ASCII(std::wstring_view text, std::string & converted)
+		{
+			converted.clear();
+			converted.reserve(text.size());
+
 			for (auto it = text.begin(); it != text.end(); it++)
 			{
 				if (*it >= 0xD800 && *it <= 0xDFFF)
@@ -39,22 +54,37 @@ namespace encoding
 					}
 				}
 			}
-
-			return converted;
 		}
 
 		std::wstring convertASCII_UTF16(std::string_view text)
 		{
 			std::wstring converted{};
+			convertASCII_UTF16(text, converted);
+			return converted;
+		}
+
+		void convertASCII_UTF16(std::string_view text, std::wstring & converted)
+		{
+			converted.clear();
+			converted.reserve(text.size());
+
 			std::transform(text.begin(), text.end(), std::back_insert_iterator<std::wstring>(converted),
 				[](char x) { if (static_cast<unsigned char>(x) > 127) { throw ConvertionError{ "Invalid ASCII encoding" }; } return x; }
 			);
-			return converted;
 		}
 
 		std::string convertURLEncode_UTF8(std::string_view text)
 		{
 			std::string converted{};
+			convertURLEncode_UTF8(text, converted);
+			return converted;
+		}
+
+		void convertURLEncode_UTF8(std::string_view text, std::string & converted)
+		{
+			converted.clear();
+			converted.reserve(text.size());
+
 			for (auto it = text.begin(); it != text.end(); it++)
 			{
 				switch (*it)
@@ -78,12 +108,12 @@ namespace encoding
 					if (it == text.end()) { throw ConvertionError{ "Invalid URLEncode encoding" }; }
 					hex.at(1) = *it;
 
-					char character;
+					unsigned char character;
 					auto[ptr, ec] = std::from_chars(hex.data(), hex.data() + 2, character, 16);
 
-					if (ptr != hex.data() + 2) { throw ConvertionError{ "Invalid URLEncode encoding" }; }
+					if (ec != std::errc{} || ptr != hex.data() + 2) { throw ConvertionError{ "Invalid URLEncode encoding" }; }
 
-					converted += character;
+					converted += static_cast<char>(character);
 
 				}
 				break;
@@ -93,18 +123,17 @@ namespace encoding
 					break;
 				}
 			}
-
-			return converted;
 		}
 
 		void convertURLEncode_UTF8(std::string && text)
 		{
-			for (auto it = text.begin(); it != text.end(); it++)
+			auto converted = text.begin(); // The decoded text is never longer, so it is written over the part already read
+			for (auto it = text.begin(); it != text.end(); it++, converted++)
 			{
 				switch (*it)
 				{
 				case '+':
-					*it = ' ';
+					*converted = ' ';
 					break;
 
 				case ' ':
@@ -115,32 +144,44 @@ namespace encoding
 				{
 					std::array<char, 2> hex{};
 
-					it = text.erase(it);
+					it++;
 					if (it == text.end()) { throw ConvertionError{ "Invalid URLEncode encoding" }; }
 					hex.at(0) = *it;
-					it = text.erase(it);
+					it++;
 					if (it == text.end()) { throw ConvertionError{ "Invalid URLEncode encoding" }; }
 					hex.at(1) = *it;
 
-					char character;
+					unsigned char character;
 					auto[ptr, ec] = std::from_chars(hex.data(), hex.data() + 2, character, 16);
 
-					if (ptr != hex.data() + 2) { throw ConvertionError{ "Invalid URLEncode encoding" }; }
+					if (ec != std::errc{} || ptr != hex.data() + 2) { throw ConvertionError{ "Invalid URLEncode encoding" }; }
 
-					*it = character;
+					*converted = static_cast<char>(character);
 
 				}
 				break;
 
 				default:
+					*converted = *it;
 					break;
 				}
 			}
+
+			text.erase(converted, text.end());
 		}
 
 		std::string convertUTF8_URLEncode(std::string_view text)
 		{
 			std::string converted{};
+			convertUTF8_URLEncode(text, converted);
+			return converted;
+		}
+
+		void convertUTF8_URLEncode(std::string_view text, std::string & converted)
+		{
+			converted.clear();
+			converted.reserve(text.size());
+
 			for (auto it = text.begin(); it != text.end(); it++)
 			{
 				if (std::isalnum(*it))
@@ -149,32 +190,36 @@ namespace encoding
 				}
 				else
 				{
-					std::string hex{ "FF" };
-					auto[ptr, ec] = std::to_chars(hex.data(), hex.data() + 2, static_cast<unsigned char>(*it), 16);
-
-					if (ptr != hex.data() + 2) { throw ConvertionError{ "Invalid ASCII encoding" }; }
+					auto x = static_cast<unsigned char>(*it);
 
 					converted += '%';
-					converted += hex;
+					converted += hex_digits[x >> 4];
+					converted += hex_digits[x & 0xF];
 				}
 			}
-
-			return converted;
 		}
 
 		void convertUTF8_URLEncode(std::string && text)
 		{
-			for (std::size_t i = 0; i < text.size(); i++)
+			auto escaped = static_cast<std::size_t>(std::count_if(text.begin(), text.end(), [](char x) { return !std::isalnum(x); }));
+			auto size = text.size();
+
+			text.resize(size + 2 * escaped);
+
+			for (std::size_t i = size, j = text.size(); i > 0;) //Fill from the back, so nothing is overwritten before it is read
 			{
-				if (!std::isalnum(text.at(i)))
+				--i;
+				if (std::isalnum(text.at(i)))
 				{
-					std::string hex{ "FF" };
-					auto[ptr, ec] = std::to_chars(hex.data(), hex.data() + 2, static_cast<unsigned char>(text.at(i)), 16);
-
-					if (ptr != hex.data() + 2) { throw ConvertionError{ "Invalid ASCII encoding" }; }
+					text.at(--j) = text.at(i);
+				}
+				else
+				{
+					auto x = static_cast<unsigned char>(text.at(i));
 
-					text.replace(i, 1, '%' + hex);
-					i += 2;
+					text.at(--j) = hex_digits[x & 0xF];
+					text.at(--j) = hex_digits[x >> 4];
+					text.at(--j) = '%';
 				}
 			}
 		}
@@ -335,6 +380,14 @@ namespace encoding
 		std::wstring convertUTF8_UTF16(std::string_view text)
 		{
 			std::wstring converted{};
+			convertUTF8_UTF16(text, converted);
+			return converted;
+		}
+
+		void convertUTF8_UTF16(std::string_view text, std::wstring & converted)
+		{
+			converted.clear();
+			converted.reserve(text.size());
 
 			for (auto it = text.begin(); it != text.end();)
 			{
@@ -381,13 +434,19 @@ namespace encoding
 					converted += character_UTF16.at(i);
 				}
 			}
-
-			return converted;
 		}
 
 		std::string convertUTF16_UTF8(std::wstring_view text)
 		{
 			std::string converted{};
+			convertUTF16_UTF8(text, converted);
+			return converted;
+		}
+
+		void convertUTF16_UTF8(std::wstring_view text, std::string & converted)
+		{
+			converted.clear();
+			converted.reserve(text.size());
 
 			for (auto it = text.begin(); it != text.end();)
 			{
@@ -422,9 +481,300 @@ namespace encoding
 					converted += character_UTF8.at(i);
 				}
 			}
+		}
+
+		//Length of the prefix which JSONString keeps unchanged, 8 bytes are checked at once (see Swar.h)
+		std::size_t safeJSONStringLength(std::string_view text, bool escape_non_ascii) noexcept
+		{
+			std::size_t i = 0;
+			for (; i + sizeof(std::uint64_t) <= text.size(); i += sizeof(std::uint64_t))
+			{
+				auto word = swar::loadWord(text.data() + i);
+				if ((swar::bytesBelow(word, 0x20) | swar::bytesEqual(word, '"') | swar::bytesEqual(word, '\\') | (escape_non_ascii ? word & swar::lanes_high : 0)) != 0)
+				{
+					break;
+				}
+			}
+
+			for (; i < text.size(); i++)
+			{
+				auto x = static_cast<unsigned char>(text[i]);
+				if (x < 0x20 || x == '"' || x == '\\' || (escape_non_ascii && x >= 0x80))
+				{
+					break;
+				}
+			}
+
+			return i;
+		}
+
+		void appendUnicodeEscape(std::string & converted, char16_t unit)
+		{
+			converted += "\\u";
+			converted += hex_digits[(unit >> 12) & 0xF];
+			converted += hex_digits[(unit >> 8) & 0xF];
+			converted += hex_digits[(unit >> 4) & 0xF];
+			converted += hex_digits[unit & 0xF];
+		}
+
+		std::string convertUTF8_JSONString(std::string_view text, bool escape_non_ascii)
+		{
+			std::string converted{};
+			convertUTF8_JSONString(text, converted, escape_non_ascii);
+			return converted;
+		}
+
+		void convertUTF8_JSONString(std::string_view text, std::string & converted, bool escape_non_ascii)
+		{
+			converted.clear();
+			converted.reserve(text.size());
+
+			for (std::size_t i = 0; i < text.size();)
+			{
+				auto safe = safeJSONStringLength(text.substr(i), escape_non_ascii);
+				if (!escape_non_ascii && !isUTF8(text.substr(i, safe))) // The run ends with an ascii byte, so it can't end inside a character
+				{
+					throw ConvertionError{ "Invalid UTF8 encoding" };
+				}
+
+				converted.append(text.data() + i, safe);
+				i += safe;
+
+				if (i == text.size())
+				{
+					break;
+				}
+
+				unsigned char first_byte = text[i];
+				if (first_byte >= 0x80)
+				{
+					std::array<unsigned char, 4> character_utf8;
+					unsigned char character_lenght;
+
+					if (first_byte < 0xE0)
+						character_lenght = 2;
+					else if (first_byte < 0xF0)
+						character_lenght = 3;
+					else if (first_byte < 0xF5)
+						character_lenght = 4;
+					else
+						throw ConvertionError{ "Invalid UTF8 encoding" };
+
+					if (text.size() - i < character_lenght || !isUTF8(text.substr(i, character_lenght)))
+					{
+						throw ConvertionError{ "Invalid UTF8 encoding" };
+					}
+
+					for (std::size_t j = 0; j < character_lenght; j++)
+					{
+						character_utf8.at(j) = text[i++];
+					}
+
+					auto[size, character_UTF16] = characterToUTF16(characterFromUTF8(character_lenght, character_utf8));
+
+					for (char j = 0; j < size; j++)
+					{
+						appendUnicodeEscape(converted, character_UTF16.at(j));
+					}
+
+					continue;
+				}
+
+				switch (first_byte)
+				{
+				case '"': converted += "\\\""; break;
+				case '\\': converted += "\\\\"; break;
+				case '\b': converted += "\\b"; break;
+				case '\f': converted += "\\f"; break;
+				case '\n': converted += "\\n"; break;
+				case '\r': converted += "\\r"; break;
+				case '\t': converted += "\\t"; break;
+				default: appendUnicodeEscape(converted, first_byte); break;
+				}
+
+				i++;
+			}
+		}
+
+		char16_t unicodeEscapeUnit(std::string_view text, std::size_t position) // position of '\'
+		{
+			unsigned int unit;
+			if (text.size() - position < 6 || text[position] != '\\' || text[position + 1] != 'u')
+			{
+				throw ConvertionError{ "Invalid JSONString encoding" };
+			}
+
+			if (auto[ptr, ec] = std::from_chars(text.data() + position + 2, text.data() + position + 6, unit, 16); ec != std::errc{} || ptr != text.data() + position + 6)
+			{
+				throw ConvertionError{ "Invalid JSONString encoding" };
+			}
+
+			return static_cast<char16_t>(unit);
+		}
+
+		//Writes the decoded text to output and returns its end
+		//The decoded text is never longer, so output may point at the text itself
+		char * decodeJSONString(std::string_view text, char * output)
+		{
+			for (std::size_t i = 0; i < text.size();)
+			{
+				auto safe = safeJSONStringLength(text.substr(i), false);
+				if (!isUTF8(text.substr(i, safe))) // The run ends with an ascii byte, so it can't end inside a character
+				{
+					throw ConvertionError{ "Invalid JSONString encoding" };
+				}
+
+				std::memmove(output, text.data() + i, safe);
+				output += safe;
+				i += safe;
+
+				if (i == text.size())
+				{
+					break;
+				}
+
+				if (text[i] != '\\' || i + 1 == text.size()) // Unescaped control character or '"'
+				{
+					throw ConvertionError{ "Invalid JSONString encoding" };
+				}
+
+				switch (text[i + 1])
+				{
+				case '"': *output++ = '"'; break;
+				case '\\': *output++ = '\\'; break;
+				case '/': *output++ = '/'; break;
+				case 'b': *output++ = '\b'; break;
+				case 'f': *output++ = '\f'; break;
+				case 'n': *output++ = '\n'; break;
+				case 'r': *output++ = '\r'; break;
+				case 't': *output++ = '\t'; break;
+				case 'u':
+				{
+					std::array<char16_t, 2> character_utf16{ unicodeEscapeUnit(text, i) };
+					unsigned char character_lenght = 1;
+
+					if (character_utf16.at(0) >= 0xD800 && character_utf16.at(0) <= 0xDFFF) // Characters above 0xFFFF are escaped as surrogate pairs
+					{
+						character_utf16.at(1) = unicodeEscapeUnit(text, i + 6);
+						character_lenght = 2;
+					}
+
+					auto[size, character_UTF8] = characterToUTF8(characterFromUTF16(character_lenght, character_utf16));
+
+					for (char j = 0; j < size; j++)
+					{
+						*output++ = static_cast<char>(character_UTF8.at(j));
+					}
+
+					i += 6 * character_lenght;
+					continue;
+				}
+
+				default:
+					throw ConvertionError{ "Invalid JSONString encoding" };
+				}
+
+				i += 2;
+			}
+
+			return output;
+		}
 
+		std::string convertJSONString_UTF8(std::string_view text)
+		{
+			std::string converted{};
+			convertJSONString_UTF8(text, converted);
 			return converted;
 		}
 
+		void convertJSONString_UTF8(std::string_view text, std::string & converted)
+		{
+			converted.resize(text.size());
+			converted.resize(static_cast<std::size_t>(decodeJSONString(text, converted.data()) - converted.data()));
+		}
+
+		void convertJSONString_UTF8(std::string && text)
+		{
+			text.resize(static_cast<std::size_t>(decodeJSONString(text, text.data()) - text.data()));
+		}
+
+		//The scans check 8 bytes at once (see Swar.h)
+
+		template<typename WordTest, typename ByteTest>
+		bool allBytes(std::string_view text, WordTest && word_test, ByteTest && byte_test) noexcept
+		{
+			std::size_t i = 0;
+			for (; i + sizeof(std::uint64_t) <= text.size(); i += sizeof(std::uint64_t))
+			{
+				if (!word_test(swar::loadWord(text.data() + i)))
+				{
+					return false;
+				}
+			}
+
+			for (; i < text.size(); i++)
+			{
+				if (!byte_test(static_cast<unsigned char>(text[i])))
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+
+		bool isASCII(std::string_view text) noexcept
+		{
+			return allBytes(text,
+				[](std::uint64_t word) { return (word & swar::lanes_high) == 0; },
+				[](unsigned char x) { return x < 0x80; });
+		}
+
+		bool isASCII(std::wstring_view text) noexcept
+		{
+			return std::all_of(text.begin(), text.end(), [](wchar_t x) { return static_cast<std::make_unsigned_t<wchar_t>>(x) < 0x80; });
+		}
+
+		bool isUTF8(std::string_view text) noexcept
+		{
+			helpers::UTF8Validator validator{};
+			for (std::size_t i = 0; i < text.size();)
+			{
+				if (validator.idle() && i + sizeof(std::uint64_t) <= text.size() && (swar::loadWord(text.data() + i) & swar::lanes_high) == 0) // 8 ascii bytes
+				{
+					i += sizeof(std::uint64_t);
+					continue;
+				}
+
+				validator.next(static_cast<unsigned char>(text[i++]));
+			}
+
+			return validator.isValid();
+		}
+
+		bool isIdentityURLEncode_UTF8(std::string_view text) noexcept
+		{
+			return allBytes(text,
+				[](std::uint64_t word) { return (swar::bytesEqual(word, '%') | swar::bytesEqual(word, '+') | swar::bytesEqual(word, ' ')) == 0; },
+				[](unsigned char x) { return x != '%' && x != '+' && x != ' '; });
+		}
+
+		bool isIdentityUTF8_URLEncode(std::string_view text) noexcept
+		{
+			return allBytes(text,
+				[](std::uint64_t word) { return (word & swar::lanes_high) == 0 && (swar::bytesInRange(word, '0', '9') | swar::bytesInRange(word, 'A', 'Z') | swar::bytesInRange(word, 'a', 'z')) == swar::lanes_high; },
+				[](unsigned char x) { return (x >= '0' && x <= '9') || (x >= 'A' && x <= 'Z') || (x >= 'a' && x <= 'z'); });
+		}
+
+		bool isIdentityUTF8_JSONString(std::string_view text, bool escape_non_ascii) noexcept
+		{
+			return safeJSONStringLength(text, escape_non_ascii) == text.size() && (escape_non_ascii || isUTF8(text));
+		}
+
+		bool isIdentityJSONString_UTF8(std::string_view text) noexcept
+		{
+			return safeJSONStringLength(text, false) == text.size() && isUTF8(text);
+		}
+
 	}
 }
@@ -3,6 +3,7 @@
 
 #include <exception>
 #include <string>
+#include <string_view>
 #include <algorithm>
 #include <iterator>
 
@@ -25,19 +26,46 @@ namespace encoding
 
 	namespace converters
 	{
+		//Overloads with the output argument clear it and reuse its capacity
+
 		std::string convertUTF16_ASCII(std::wstring_view text); // Every non ascii (0-127) character will be casted to 128
+		void convertUTF16_ASCII(std::wstring_view text, std::string & converted);
 
 		std::wstring convertASCII_UTF16(std::string_view text);
+		void convertASCII_UTF16(std::string_view text, std::wstring & converted);
 
 		std::string convertURLEncode_UTF8(std::string_view text);
+		void convertURLEncode_UTF8(std::string_view text, std::string & converted);
 		void convertURLEncode_UTF8(std::string && text);
 
 		std::string convertUTF8_URLEncode(std::string_view text);
+		void convertUTF8_URLEncode(std::string_view text, std::string & converted);
 		void convertUTF8_URLEncode(std::string && text);
 		
 		std::wstring convertUTF8_UTF16(std::string_view text);
+		void convertUTF8_UTF16(std::string_view text, std::wstring & converted);
 
 		std::string convertUTF16_UTF8(std::wstring_view text);
+		void convertUTF16_UTF8(std::wstring_view text, std::string & converted);
+
+		std::string convertUTF8_JSONString(std::string_view text, bool escape_non_ascii = false); // Non ascii characters are written as \uXXXX if escape_non_ascii
+		void convertUTF8_JSONString(std::string_view text, std::string & converted, bool escape_non_ascii = false);
+
+		std::string convertJSONString_UTF8(std::string_view text);
+		void convertJSONString_UTF8(std::string_view text, std::string & converted);
+		void convertJSONString_UTF8(std::string && text);
+
+		//Fast scans telling that a conversion would not change the text
+
+		bool isASCII(std::string_view text) noexcept;
+		bool isASCII(std::wstring_view text) noexcept;
+		bool isUTF8(std::string_view text) noexcept; // Strictly valid, without overlong forms, surrogates or characters above 0x10FFFF
+
+		bool isIdentityURLEncode_UTF8(std::string_view text) noexcept; // Without '%', '+' and ' '
+		bool isIdentityUTF8_URLEncode(std::string_view text) noexcept; // Only alphanumeric characters
+
+		bool isIdentityUTF8_JSONString(std::string_view text, bool escape_non_ascii = false) noexcept; // Valid UTF8 without control characters, '"' and '\\'
+		bool isIdentityJSONString_UTF8(std::string_view text) noexcept; // Valid UTF8 without control characters, '"' and '\\'
 
 	}
 }
@@ -0,0 +1,253 @@
+#include "Detection.h"
+#include "Swar.h"
+#include "UTF8Validator.h"
+
+#include <algorithm>
+
+namespace encoding
+{
+	namespace
+	{
+		bool isHexDigit(unsigned char x) noexcept
+		{
+			return (x >= '0' && x <= '9') || (x >= 'A' && x <= 'F') || (x >= 'a' && x <= 'f');
+		}
+
+		unsigned int hexValue(unsigned char x) noexcept
+		{
+			return x <= '9' ? x - '0' : (x | 0x20) - 'a' + 10;
+		}
+
+		class UTF16Validator
+		{
+		public:
+			void next(unsigned int unit) noexcept
+			{
+				if (expects_low_surrogate)
+				{
+					valid = valid && unit >= 0xDC00 && unit <= 0xDFFF;
+					expects_low_surrogate = false;
+				}
+				else if (unit >= 0xD800 && unit <= 0xDBFF)
+				{
+					expects_low_surrogate = true;
+				}
+				else if (unit >= 0xDC00 && unit <= 0xDFFF)
+				{
+					valid = false;
+				}
+			}
+
+			bool idle() const noexcept { return !expects_low_surrogate; }
+			bool isValid() const noexcept { return valid && !expects_low_surrogate; }
+
+		private:
+			bool expects_low_surrogate = false;
+			bool valid = true;
+		};
+
+		//Contents of a JSON string literal without the quotes, the bytes outside escapes are checked as UTF8 separately
+		class JSONStringValidator
+		{
+		public:
+			void next(unsigned char byte) noexcept
+			{
+				if (hex_pending != 0)
+				{
+					valid = valid && isHexDigit(byte);
+					unit = (unit << 4) | hexValue(byte);
+
+					if (--hex_pending == 0)
+					{
+						units.next(unit);
+					}
+				}
+				else if (after_backslash)
+				{
+					after_backslash = false;
+					if (byte == 'u')
+					{
+						hex_pending = 4;
+						unit = 0;
+						++unicode_escapes;
+					}
+					else
+					{
+						valid = valid && units.idle() && std::string_view{ "\"\\/bfnrt" }.find(static_cast<char>(byte)) != std::string_view::npos;
+						++escapes;
+					}
+				}
+				else if (byte == '\\')
+				{
+					after_backslash = true;
+				}
+				else
+				{
+					valid = valid && units.idle() && byte >= 0x20 && byte != '"'; // A high surrogate escape has to be followed by a low one
+				}
+			}
+
+			bool idle() const noexcept { return hex_pending == 0 && !after_backslash && units.idle(); }
+			bool isValid() const noexcept { return valid && hex_pending == 0 && !after_backslash && units.isValid(); }
+
+			std::size_t escapes = 0, unicode_escapes = 0; // \n like escapes, \uXXXX escapes
+
+		private:
+			UTF16Validator units{}; // Code units of the \uXXXX escapes
+			unsigned int hex_pending = 0, unit = 0;
+			bool after_backslash = false;
+			bool valid = true;
+		};
+
+		ByteOrderMark findByteOrderMark(std::string_view bytes) noexcept
+		{
+			if (bytes.substr(0, 3) == "\xEF\xBB\xBF")
+				return ByteOrderMark::UTF8;
+			else if (bytes.substr(0, 2) == "\xFF\xFE")
+				return ByteOrderMark::UTF16LE;
+			else if (bytes.substr(0, 2) == "\xFE\xFF")
+				return ByteOrderMark::UTF16BE;
+			else
+				return ByteOrderMark::none;
+		}
+	}
+
+	std::size_t byteOrderMarkLength(ByteOrderMark bom) noexcept
+	{
+		switch (bom)
+		{
+		case ByteOrderMark::UTF8:
+			return 3;
+		case ByteOrderMark::UTF16LE:
+		case ByteOrderMark::UTF16BE:
+			return 2;
+		default:
+			return 0;
+		}
+	}
+
+	ByteOrderMark detectedByteOrderMark(const DetectionCandidate & candidate) noexcept
+	{
+		if (candidate.encoding == UTF8::value)
+			return ByteOrderMark::UTF8;
+		else if (candidate.encoding == UTF16::value)
+			return candidate.big_endian ? ByteOrderMark::UTF16BE : ByteOrderMark::UTF16LE;
+		else
+			return ByteOrderMark::none;
+	}
+
+	DetectionResult detect(std::string_view bytes)
+	{
+		DetectionResult result{};
+		result.bom = findByteOrderMark(bytes);
+
+		bool ascii = true, url_encode = true;
+		std::size_t url_pending = 0, url_escapes = 0; // Hex digits expected after '%', escapes found
+		unsigned char url_escaped = 0; // Value of the escape being read
+		std::size_t zeros_even = 0, zeros_odd = 0; // Zero bytes at even and odd offsets
+		helpers::UTF8Validator utf8{}, url_utf8{}; // url_utf8 checks the decoded URLEncode text, which is always UTF8
+		UTF16Validator utf16le{}, utf16be{};
+		JSONStringValidator json_string{};
+
+		auto text = bytes.substr(byteOrderMarkLength(result.bom));
+		for (std::size_t i = 0; i < text.size();)
+		{
+			//Fast path: 8 ascii bytes without control characters, '%', ' ', '"' or '\\' don't change the state of any validator
+			if (i % 2 == 0 && i + sizeof(std::uint64_t) <= text.size() && url_pending == 0 && utf8.idle() && url_utf8.idle() && utf16le.idle() && utf16be.idle() && json_string.idle())
+			{
+				auto word = swar::loadWord(text.data() + i);
+				if ((word & swar::lanes_high) == 0 && (swar::bytesBelow(word, 0x20) | swar::bytesEqual(word, '%') | swar::bytesEqual(word, ' ') |
+					swar::bytesEqual(word, '"') | swar::bytesEqual(word, '\\')) == 0)
+				{
+					i += sizeof(std::uint64_t);
+					continue;
+				}
+			}
+
+			auto byte = static_cast<unsigned char>(text[i]);
+
+			ascii = ascii && byte < 0x80;
+			utf8.next(byte);
+			json_string.next(byte);
+
+			if (url_pending != 0)
+			{
+				url_encode = url_encode && isHexDigit(byte);
+				url_escaped = static_cast<unsigned char>((url_escaped << 4) | hexValue(byte));
+
+				if (--url_pending == 0)
+				{
+					url_utf8.next(url_escaped);
+				}
+			}
+			else if (byte == '%')
+			{
+				url_pending = 2;
+				url_escaped = 0;
+				++url_escapes;
+			}
+			else
+			{
+				url_encode = url_encode && byte != ' ' && byte < 0x80;
+				url_utf8.next(byte);
+			}
+
+			if (byte == 0)
+			{
+				++(i % 2 == 0 ? zeros_even : zeros_odd);
+			}
+
+			if (i % 2 == 1)
+			{
+				auto first = static_cast<unsigned char>(text[i - 1]);
+				utf16le.next((static_cast<unsigned int>(byte) << 8) | first);
+				utf16be.next((static_cast<unsigned int>(first) << 8) | byte);
+			}
+
+			++i;
+		}
+
+		auto utf16_length_valid = (text.size() % 2 == 0);
+		auto bom_utf16 = result.bom == ByteOrderMark::UTF16LE || result.bom == ByteOrderMark::UTF16BE;
+
+		result.is_ascii = ascii && result.bom == ByteOrderMark::none;
+		result.is_utf8 = utf8.isValid() && !bom_utf16;
+		result.is_utf16le = utf16_length_valid && utf16le.isValid() && (result.bom == ByteOrderMark::none || result.bom == ByteOrderMark::UTF16LE);
+		result.is_utf16be = utf16_length_valid && utf16be.isValid() && (result.bom == ByteOrderMark::none || result.bom == ByteOrderMark::UTF16BE);
+		result.is_url_encode = url_encode && url_pending == 0 && url_utf8.isValid() && result.bom == ByteOrderMark::none;
+		result.is_json_string = json_string.isValid() && utf8.isValid() && result.bom == ByteOrderMark::none;
+
+		//Text in UTF8 or ascii rarely contains zeros, ascii-heavy UTF16 has a zero in (almost) every unit
+		auto has_zeros = zeros_even + zeros_odd != 0;
+		auto units = std::max<std::size_t>(text.size() / 2, 1);
+		auto utf16Confidence = [&](ByteOrderMark bom, std::size_t high_zeros, std::size_t low_zeros) -> unsigned int {
+			if (result.bom == bom)
+				return 100;
+
+			return static_cast<unsigned int>(10 + (60 * high_zeros) / units - std::min<std::size_t>((30 * low_zeros) / units, 10));
+		};
+
+		auto add = [&result](std::size_t encoding, bool big_endian, unsigned int confidence) {
+			result.candidates.at(result.candidates_count++) = { encoding, big_endian, confidence };
+		};
+
+		if (result.is_url_encode)
+			add(URLEncode::value, false, has_zeros ? 5 : url_escapes != 0 ? 95 : 40);
+		if (result.is_ascii)
+			add(ASCII::value, false, has_zeros ? 20 : url_escapes != 0 ? 70 : 90);
+		if (result.is_utf8)
+			add(UTF8::value, false, result.bom == ByteOrderMark::UTF8 ? 100 : has_zeros ? 15 : ascii ? 85 : 95);
+		if (result.is_utf16le)
+			add(UTF16::value, false, utf16Confidence(ByteOrderMark::UTF16LE, zeros_odd, zeros_even));
+		if (result.is_utf16be)
+			add(UTF16::value, true, utf16Confidence(ByteOrderMark::UTF16BE, zeros_even, zeros_odd));
+		//\uXXXX is hardly written by hand, while plain text may contain a backslash followed by n or t (e.g. a Windows path)
+		if (result.is_json_string)
+			add(JSONString::value, false, json_string.unicode_escapes != 0 ? 96 : json_string.escapes != 0 ? 80 : 30);
+
+		std::stable_sort(result.candidates.begin(), result.candidates.begin() + result.candidates_count,
+			[](const DetectionCandidate & x, const DetectionCandidate & y) { return x.confidence > y.confidence; });
+
+		return result;
+	}
+}
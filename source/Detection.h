@@ -0,0 +1,140 @@
+#ifndef DETECTION_H
+#define DETECTION_H
+
+#include "Encoder.h"
+
+#include <array>
+#include <string>
+#include <string_view>
+
+namespace encoding
+{
+	enum class ByteOrderMark { none, UTF8, UTF16LE, UTF16BE };
+
+	struct DetectionCandidate
+	{
+		std::size_t encoding; // encoding_code value
+		bool big_endian; // Byte order of UTF16
+		unsigned int confidence; // 0 - 100
+	};
+
+	struct DetectionResult
+	{
+		ByteOrderMark bom;
+
+		bool is_ascii;
+		bool is_utf8;
+		bool is_utf16le;
+		bool is_utf16be;
+		bool is_url_encode;
+		bool is_json_string;
+
+		std::array<DetectionCandidate, encoding_count + 1> candidates; // Valid encodings, the most probable first (UTF16 may be valid in both byte orders)
+		std::size_t candidates_count;
+
+		const DetectionCandidate * begin() const noexcept { return candidates.data(); }
+		const DetectionCandidate * end() const noexcept { return candidates.data() + candidates_count; }
+	};
+
+	//Checks every detectable encoding in a single pass over the bytes (8 bytes at once over ascii text)
+	//Pass a prefix of the payload for a quicker guess, a valid prefix does not guarantee a valid payload
+	DetectionResult detect(std::string_view bytes);
+
+	std::size_t byteOrderMarkLength(ByteOrderMark bom) noexcept;
+	ByteOrderMark detectedByteOrderMark(const DetectionCandidate & candidate) noexcept; // The BOM the candidate encoding would start with
+
+	namespace helpers
+	{
+		//Every encoder generated for To has the same output type, a lossy path exists whenever a lossless one does
+		template<typename To>
+		using detected_output_t = typename encoding::makeEncoder<std::conditional_t<std::is_same_v<To, UTF8>, UTF16, UTF8>, To, false>::output_type;
+
+		template<typename To, typename... T>
+		constexpr bool isReachableLosslessly(EncodingList<T...>) noexcept
+		{
+			return ((std::is_same_v<T, To> || lossless_next_hops.at(T::value * encoding_count + To::value) != npos) && ...);
+		}
+
+		//Every encoding can be converted to To without loss
+		template<typename To>
+		constexpr bool is_reachable_losslessly = isReachableLosslessly<To>(encodings{});
+
+		//UTF16 code units stored in bytes
+		template<typename CharT>
+		inline std::basic_string<CharT> unitsFromUTF16Bytes(std::string_view bytes, bool big_endian)
+		{
+			std::basic_string<CharT> units(bytes.size() / 2, CharT{});
+			for (std::size_t i = 0; i < units.size(); i++)
+			{
+				auto first = static_cast<unsigned char>(bytes[2 * i]), second = static_cast<unsigned char>(bytes[2 * i + 1]);
+				units[i] = static_cast<CharT>(big_endian ? (first << 8) | second : (second << 8) | first);
+			}
+
+			return units;
+		}
+
+		template<typename From, typename To, bool LOSSLESS>
+		inline detected_output_t<To> convertBytes(std::string_view bytes, bool big_endian)
+		{
+			if constexpr (std::is_same_v<From, To>)
+			{
+				using output_type = detected_output_t<To>;
+				if constexpr (sizeof(typename output_type::value_type) == 1)
+					return output_type{ bytes };
+				else
+					return unitsFromUTF16Bytes<typename output_type::value_type>(bytes, big_endian);
+			}
+			else
+			{
+				using encoder_type = encoding::makeEncoder<From, To, LOSSLESS>;
+				using char_type = typename owned_input_t<encoder_type>::value_type;
+
+				if constexpr (sizeof(char_type) == 1)
+					return encoder_type{}.convert(typename encoder_type::input_type{ bytes });
+				else
+					return encoder_type{}.convert(unitsFromUTF16Bytes<char_type>(bytes, big_endian));
+			}
+		}
+	}
+
+	//Converts bytes of unknown encoding to To, the most probable valid encoding is used
+	//If the conversion fails (e.g. a prefix was valid but not the whole text), the next candidates are tried in order
+	//UTF16 bytes are read as 2 byte code units
+	//The conversion is lossless by default if every encoding has a lossless path to To (e.g. not for ASCII)
+	template<typename To, bool LOSSLESS = helpers::is_reachable_losslessly<To>>
+	helpers::detected_output_t<To> convertDetected(std::string_view bytes)
+	{
+		static_assert(!LOSSLESS || helpers::is_reachable_losslessly<To>, "Not every encoding can be converted to To without loss, use LOSSLESS = false");
+
+		auto detection = detect(bytes);
+
+		for (std::size_t i = 0; i < detection.candidates_count; i++)
+		{
+			const auto & candidate = detection.candidates.at(i);
+
+			auto text = bytes;
+			if (detection.bom == detectedByteOrderMark(candidate))
+			{
+				text.remove_prefix(byteOrderMarkLength(detection.bom));
+			}
+
+			try
+			{
+				return visitEncoding<helpers::detected_output_t<To>>(candidate.encoding, [&](auto from) {
+					return helpers::convertBytes<decltype(from), To, LOSSLESS>(text, candidate.big_endian);
+				});
+			}
+			catch (const ConvertionError &)
+			{
+				if (i + 1 == detection.candidates_count)
+				{
+					throw;
+				}
+			}
+		}
+
+		throw ConvertionError{ "Unknown encoding" };
+	}
+}
+
+#endif // !DETECTION_H
\ No newline at end of file
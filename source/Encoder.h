@@ -2,11 +2,11 @@
 #define ENCODER_H
 
 #include "BaseEncoders.h"
+#include "Instrumentation.h"
 
 
 #include <utility>
 #include <array>
-#include <cassert>
 
 namespace encoding
 {
@@ -47,6 +47,14 @@ namespace encoding
 			return false;
 	}
 
+	template<typename T>
+	constexpr inline bool isInPlaceEncoder() noexcept {
+		if constexpr (isEncoder<T>())
+			return helpers::isInPlaceEncoder<T>::value;
+		else
+			return false;
+	}
+
 	template<typename T, typename U>
 	constexpr inline bool canBeCombinedEncoder() noexcept {
 		if constexpr (isEncoder<T>() && isEncoder<U>())
@@ -64,12 +72,72 @@ namespace encoding
 
 		using is_base_encoder = std::false_type;
 		using is_lossless = std::conditional_t<T::is_lossless::value && U::is_lossless::value, std::true_type, std::false_type>;
+		using is_ascii_transparent = std::conditional_t<helpers::isAsciiTransparent<T>::value && helpers::isAsciiTransparent<U>::value, std::true_type, std::false_type>;
+
+		CombinedEncoder() = default;
+
+		//The arguments configure the last stage, e.g. makeEncoder<UTF16, JSONString>{ true } escapes non ascii characters
+		template<typename... Args, std::enable_if_t<(sizeof...(Args) > 0) && std::is_constructible_v<U, Args &&...>, int> = 0>
+		explicit CombinedEncoder(Args &&... args) : u{ std::forward<Args>(args)... } {}
 
 		output_type convert(input_type text) const
 		{
-			U u; T t;
-			return u.convert(t.convert(text));
+			return helpers::consume(u, t.convert(text));
+		}
+
+		//Consumes the text, every in-place stage converts the buffer it gets instead of copying it
+		template<typename Text, std::enable_if_t<std::is_same_v<Text, helpers::owned_input_t<T>>, int> = 0>
+		output_type convert(Text && text) const
+		{
+			return helpers::consume(u, helpers::consume(t, std::move(text)));
+		}
+
+		//Reuses the capacity of the output and of the intermediate buffer owned by this object,
+		//so converting chunk after chunk does not allocate (the object is not const, so it isn't shared between threads)
+		void convert(input_type text, output_type & output)
+		{
+			helpers::convertInto(t, text, intermediate);
+			helpers::convertInto(u, intermediate, output);
+		}
+
+		//Reuses only the capacity of the output, const objects are safe to share between threads
+		void convert(input_type text, output_type & output) const
+		{
+			typename T::output_type converted{};
+
+			helpers::convertInto(t, text, converted);
+			helpers::convertInto(u, converted, output);
+		}
+
+		//Borrows the text when the whole chain would not change it, otherwise skips every stage which would not change its input
+		auto convertOrBorrow(input_type text) const->helpers::borrowed_output_t<CombinedEncoder>
+		{
+			if constexpr (is_ascii_transparent::value && std::is_same_v<typename helpers::owned_input_t<T>::value_type, typename output_type::value_type>)
+			{
+				if (converters::isASCII(text))
+				{
+					return typename helpers::borrowed_output_t<CombinedEncoder>::view_type{ text };
+				}
+			}
+
+			auto first = helpers::convertOrBorrow(t, text);
+			auto second = helpers::convertOrBorrow(u, first.view());
+
+			if constexpr (std::is_same_v<decltype(first), decltype(second)>)
+			{
+				if (second.isBorrowed() && !first.isBorrowed())
+				{
+					return first; // second views the text owned by first
+				}
+			}
+
+			return second;
 		}
+
+	private:
+		T t{};
+		U u{};
+		typename T::output_type intermediate{};
 	};
 
 	namespace helpers
@@ -86,143 +154,160 @@ namespace encoding
 
 	namespace helpers
 	{
-		template<std::size_t parent, std::size_t child>
-		inline constexpr auto generateConnectionsMatrixRow(std::array<std::pair<bool, bool>, encoding_count * encoding_count> connections)->std::array<std::pair<bool, bool>, encoding_count * encoding_count>
-		{
-			if constexpr (child == encoding_count)
-			{
-				return connections;
-			}
-			else
-			{
-				if constexpr (existsBaseEncoder<encoding_code<parent>, encoding_code<child>>())
-				{
-					connections.at(parent * encoding_count + child).first = true;
-					connections.at(parent * encoding_count + child).second = isLosslessEncoder<Encoder< encoding_code<parent>, encoding_code<child>>>();
-				}
-				else
-				{
-					connections.at(parent * encoding_count + child).first = false;
-					connections.at(parent * encoding_count + child).second = false;
-				}
+		constexpr std::size_t npos = static_cast<std::size_t>(-1);
 
-				return generateConnectionsMatrixRow<parent, child + 1>(connections);
-			}
+		template<typename... P>
+		constexpr bool areBaseEncoders(BaseEncoderList<P...>) noexcept
+		{
+			return (isBaseEncoder<Encoder<typename P::from, typename P::to>>() && ...);
 		}
 
-		template<std::size_t encoding_code>
-		inline constexpr auto generateConnectionsMatrixColumn(std::array<std::pair<bool, bool>, encoding_count * encoding_count> connections = {})->std::array<std::pair<bool, bool>, encoding_count * encoding_count>
+		static_assert(areBaseEncoders(base_encoders{}), "Every pair in base_encoders must have a base encoder");
+
+		struct Connection
 		{
-			if constexpr (encoding_code == encoding_count)
-			{
-				return connections;
-			}
-			else
+			std::size_t from;
+			std::size_t to;
+			bool lossless;
+		};
+
+		//The registered base encoders sorted by (from, to), only these encoders are instantiated
+		template<typename... P>
+		inline constexpr std::array<Connection, sizeof...(P)> generateConnections(BaseEncoderList<P...>) noexcept
+		{
+			std::array<Connection, sizeof...(P)> sorted{ Connection{ P::from::value, P::to::value, isLosslessEncoder<Encoder<typename P::from, typename P::to>>() }... };
+			for (std::size_t i = 1; i < sorted.size(); ++i) //Insertion sort
 			{
-				return generateConnectionsMatrixColumn<encoding_code + 1>(generateConnectionsMatrixRow<encoding_code, 0>(connections));
+				for (std::size_t j = i; j > 0 && (sorted.at(j - 1).from > sorted.at(j).from || (sorted.at(j - 1).from == sorted.at(j).from && sorted.at(j - 1).to > sorted.at(j).to)); --j)
+				{
+					auto previous = sorted.at(j - 1);
+					sorted.at(j - 1) = sorted.at(j);
+					sorted.at(j) = previous;
+				}
 			}
+
+			return sorted;
 		}
 
-		constexpr static std::array<std::pair<bool, bool>, encoding_count * encoding_count> connections{ generateConnectionsMatrixColumn<0>() };
+		constexpr static auto connections = generateConnections(base_encoders{});
 
-		inline constexpr std::array<std::size_t, encoding_count + 1> generatePath(std::size_t begin, std::size_t end, bool lossless)
+		//The connections from an encoding are connections[connections_begin[from]] .. connections[connections_begin[from + 1] - 1]
+		inline constexpr std::array<std::size_t, encoding_count + 1> generateConnectionsBegin() noexcept
 		{
-			constexpr std::size_t npos = -1;
+			std::array<std::size_t, encoding_count + 1> begin{};
+			for (auto & connection : connections)
+				++begin.at(connection.from + 1);
 
-			std::array<std::size_t, encoding_count + 1> queue{ begin };
-			std::size_t p = 0, q = 1, current_encoding = begin;
-			std::array<std::size_t, encoding_count> parents{};
-			for (auto & x : parents) //fill the array with npos
-				x = npos;
+			for (std::size_t i = 1; i <= encoding_count; ++i)
+				begin.at(i) += begin.at(i - 1);
 
-			while (p != q)
-			{
-				current_encoding = queue.at(p);
-				++p;
+			return begin;
+		}
+
+		constexpr static std::array<std::size_t, encoding_count + 1> connections_begin{ generateConnectionsBegin() };
 
+		//next_hops[from * encoding_count + to] = the second encoding on the shortest path from -> to, npos if the path doesn't exist
+		//Every shortest path is continued by the shortest path from its next hop, so generated encoders share their tails
+		//The BFS walks only the registered connections, N * (N + base encoder count) steps instead of N^3
+		inline constexpr std::array<std::size_t, encoding_count * encoding_count> generateNextHops(bool lossless)
+		{
+			std::array<std::size_t, encoding_count * encoding_count> distances{};
+			for (std::size_t begin = 0; begin < encoding_count; ++begin) //BFS from every encoding
+			{
 				for (std::size_t i = 0; i < encoding_count; ++i)
+					distances.at(begin * encoding_count + i) = npos;
+
+				std::array<std::size_t, encoding_count> queue{ begin };
+				distances.at(begin * encoding_count + begin) = 0;
+
+				for (std::size_t p = 0, q = 1; p != q; ++p)
 				{
-					if (auto connection = connections.at(current_encoding * encoding_count + i); connection.first && parents.at(i) == npos && (connection.second || !lossless))
+					auto current_encoding = queue.at(p);
+					for (auto c = connections_begin.at(current_encoding); c != connections_begin.at(current_encoding + 1); ++c)
 					{
-						parents.at(i) = current_encoding;
-						queue.at(q) = i;
-						++q;
+						if (auto & connection = connections.at(c); distances.at(begin * encoding_count + connection.to) == npos && (connection.lossless || !lossless))
+						{
+							distances.at(begin * encoding_count + connection.to) = distances.at(begin * encoding_count + current_encoding) + 1;
+							queue.at(q) = connection.to;
+							++q;
+						}
 					}
 				}
 			}
 
-			parents.at(begin) = npos;
-
-			assert(parents.at(end) != npos); //Path does't exist
-
-			std::array<std::size_t, encoding_count + 1> rpath{}; //the reverse path
-			for (auto & x : rpath) //fill the array with npos
-				x = npos;
-			rpath.at(0) = npos;
-			rpath.at(1) = end;
-
-			current_encoding = end;
-			q = 2;
-			while (parents.at(current_encoding) != npos)
+			std::array<std::size_t, encoding_count * encoding_count> next_hops{};
+			for (std::size_t begin = 0; begin < encoding_count; ++begin)
 			{
-				current_encoding = rpath.at(q) = parents.at(current_encoding);
-				q++;
-			}
-
-			std::array<std::size_t, encoding_count + 1> path{};
-			for (auto & x : path) //fill the array with npos
-				x = npos;
-
-			for (std::size_t i = encoding_count, j = 0; i >= 0 + 1; i--) //reverse the rpath
-			{															 //don't copy npos
-				if (rpath.at(i) != npos)
+				for (std::size_t end = 0; end < encoding_count; ++end)
 				{
-					path.at(j) = rpath.at(i);
-					j++;
+					auto & next_hop = next_hops.at(begin * encoding_count + end);
+					next_hop = npos;
+
+					for (auto c = connections_begin.at(begin); c != connections_begin.at(begin + 1) && begin != end && distances.at(begin * encoding_count + end) != npos && next_hop == npos; ++c)
+					{
+						if (auto & connection = connections.at(c); (connection.lossless || !lossless) &&
+							distances.at(connection.to * encoding_count + end) + 1 == distances.at(begin * encoding_count + end))
+						{
+							next_hop = connection.to;
+						}
+					}
 				}
 			}
 
-			return path;
+			return next_hops;
 		}
 
+		constexpr static std::array<std::size_t, encoding_count * encoding_count> lossless_next_hops{ generateNextHops(true) };
+		constexpr static std::array<std::size_t, encoding_count * encoding_count> next_hops{ generateNextHops(false) };
+
 		template<typename T, typename U, bool LOSSLESS>
-		static constexpr std::array<std::size_t, encoding_count + 1> path{ generatePath(T::value, U::value, LOSSLESS) };
+		constexpr std::size_t next_hop = (LOSSLESS ? lossless_next_hops : next_hops).at(T::value * encoding_count + U::value);
 
-		template<typename T, typename U>
-		constexpr inline bool existsLosslessBaseEncoder()
+		//Recurses once per hop, the tail of a path is the same type for every path which reaches it
+		template<typename T, typename U, bool LOSSLESS, bool DIRECT = next_hop<T, U, LOSSLESS> == U::value>
+		struct makeEncoder
 		{
-			if constexpr (existsBaseEncoder<T, U>())
-			{
-				return Encoder<T, U>::is_lossless();
-			}
-			else
-			{
-				return false;
-			}
-		}
+			static_assert(next_hop<T, U, LOSSLESS> != npos, "Path doesn't exist");
 
-		template<typename T, typename U, bool LOSSLESS, std::enable_if_t<existsBaseEncoder<T, U>() && (!LOSSLESS || existsLosslessBaseEncoder<T, U>()), int> = 0>
-		constexpr inline auto makeEncoder() noexcept->Encoder<T, U>;
+			using next = encoding_code<next_hop<T, U, LOSSLESS>>;
+			using type = instrumented_t<T, U, CombinedEncoder<
+				instrumented_t<T, next, Encoder<T, next>>,
+				typename makeEncoder<next, U, LOSSLESS>::type>>;
+		};
 
-		template<std::size_t N, const std::array<std::size_t, N> & arr, std::size_t INDEX>
-		auto makeCombinedEncoder(typename std::enable_if_t<arr[INDEX + 2] == -1, bool> = true)->Encoder<encoding_code<arr[INDEX]>, encoding_code<arr[INDEX + 1]>>;
-		
-		template<std::size_t N, const std::array<std::size_t, N> & arr, std::size_t INDEX>
-		auto makeCombinedEncoder(typename std::enable_if_t<arr[INDEX + 2] != -1, bool> = true)
+		template<typename T, typename U, bool LOSSLESS>
+		struct makeEncoder<T, U, LOSSLESS, true>
 		{
-			return decltype(CombinedEncoder<
-				Encoder<encoding_code<arr[INDEX]>, encoding_code<arr[INDEX + 1]>>,
-				decltype(makeCombinedEncoder<N, arr, INDEX + 1>())>()
-				) {};
-		}
+			using type = instrumented_t<T, U, Encoder<T, U>>;
+		};
+	}
+
+	template<typename T, typename U, bool LOSSLESS = true>
+	using makeEncoder = typename helpers::makeEncoder<T, U, LOSSLESS>::type;
 
-		template<typename T, typename U, bool LOSSLESS, std::enable_if_t<!(existsBaseEncoder<T, U>() && (!LOSSLESS || existsLosslessBaseEncoder<T, U>())), int> = 0>
-		constexpr inline auto makeEncoder() noexcept->decltype(makeCombinedEncoder<encoding_count + 1, path<T, U, LOSSLESS>, 0>());
+	namespace helpers
+	{
+		template<typename R, typename F, typename... T>
+		inline R visitEncoding(std::size_t code, F & visitor, EncodingList<T...>)
+		{
+			using visitor_pointer = R(*)(F &);
+			constexpr visitor_pointer visitors[] = { [](F & visitor) -> R { return visitor(T{}); }... };
 
+			if (code >= sizeof...(T))
+			{
+				throw ConvertionError{ "Unknown encoding" };
+			}
+
+			return visitors[code](visitor);
+		}
 	}
 
-	template<typename T, typename U, bool LOSSLESS = true>
-	using makeEncoder = decltype(helpers::makeEncoder<T, U, LOSSLESS>());
+	//Runtime selection of the encoding, calls visitor(encoding_code<code>{}) and returns its result
+	template<typename R, typename F>
+	inline R visitEncoding(std::size_t code, F && visitor)
+	{
+		return helpers::visitEncoding<R>(code, visitor, encodings{});
+	}
 }
 
 #endif // !ENCODER_H
@@ -2,19 +2,59 @@
 #define ENCODING_H
 
 #include <type_traits>
+#include <utility>
 
 namespace encoding
 {
 	template<std::size_t U>
 	using encoding_code = std::integral_constant<std::size_t, U>;
 
-	constexpr std::size_t encoding_count = 4;	// Number of available encodings
-												// Encodings must have integral_constant values from 0 to encoding_count-1
+	template<typename... T>
+	struct EncodingList
+	{
+		static constexpr std::size_t size = sizeof...(T);
+	};
 
 	using UTF8 = encoding_code<0>;
 	using UTF16 = encoding_code<1>;
 	using URLEncode = encoding_code<2>;
 	using ASCII = encoding_code<3>;
+	using JSONString = encoding_code<4>; // Contents of a JSON string literal, UTF8 with escapes, without the quotes
+
+	using encodings = EncodingList<UTF8, UTF16, URLEncode, ASCII, JSONString>;	// Every available encoding, in the order of their codes
+
+	constexpr std::size_t encoding_count = encodings::size;
+
+	template<typename From, typename To>
+	struct EncodingPair
+	{
+		using from = From;
+		using to = To;
+	};
+
+	template<typename... T>
+	struct BaseEncoderList
+	{
+		static constexpr std::size_t size = sizeof...(T);
+	};
+
+	//Every specialization of Encoder, makeEncoder generates paths only through the base encoders listed here
+	using base_encoders = BaseEncoderList<
+		EncodingPair<UTF8, UTF16>, EncodingPair<UTF16, UTF8>,
+		EncodingPair<URLEncode, UTF8>, EncodingPair<UTF8, URLEncode>,
+		EncodingPair<UTF8, JSONString>, EncodingPair<JSONString, UTF8>,
+		EncodingPair<UTF16, ASCII>, EncodingPair<ASCII, UTF16>>;
+
+	namespace helpers
+	{
+		template<typename... T, std::size_t... I>
+		constexpr bool areCodesInOrder(EncodingList<T...>, std::index_sequence<I...>) noexcept
+		{
+			return ((T::value == I) && ...);
+		}
+	}
+
+	static_assert(helpers::areCodesInOrder(encodings{}, std::make_index_sequence<encoding_count>{}), "Encodings must have integral_constant values from 0 to encoding_count-1");
 }
 
 
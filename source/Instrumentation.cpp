@@ -0,0 +1,107 @@
+#include "Instrumentation.h"
+
+namespace encoding
+{
+	namespace instrumentation
+	{
+		namespace helpers
+		{
+			static std::array<Counters, encoding_count * encoding_count * 2> & registry() noexcept
+			{
+				static std::array<Counters, encoding_count * encoding_count * 2> counters{};
+				return counters;
+			}
+
+			void Counters::recordCall(std::size_t input_units, std::size_t output_units, std::chrono::nanoseconds time) noexcept
+			{
+				calls.fetch_add(1, std::memory_order_relaxed);
+				this->input_units.fetch_add(input_units, std::memory_order_relaxed);
+				this->output_units.fetch_add(output_units, std::memory_order_relaxed);
+
+				std::size_t bucket = 0;
+				for (auto ns = static_cast<std::uint64_t>(time.count()); ns != 0 && bucket < histogram_size - 1; ns >>= 1)
+				{
+					++bucket;
+				}
+
+				time_histogram.at(bucket).fetch_add(1, std::memory_order_relaxed);
+			}
+
+			void Counters::recordError(std::size_t input_units, const char * reason)
+			{
+				calls.fetch_add(1, std::memory_order_relaxed);
+				this->input_units.fetch_add(input_units, std::memory_order_relaxed);
+				errors.fetch_add(1, std::memory_order_relaxed);
+
+				std::lock_guard<std::mutex> lock{ error_reasons_mutex };
+				++error_reasons[reason];
+			}
+
+			EncoderStatistics Counters::load(std::size_t from, std::size_t to, bool is_base_encoder) const
+			{
+				EncoderStatistics statistics{ from, to, is_base_encoder, 0, 0, 0, 0, {}, {} };
+
+				statistics.calls = calls.load(std::memory_order_relaxed);
+				statistics.input_units = input_units.load(std::memory_order_relaxed);
+				statistics.output_units = output_units.load(std::memory_order_relaxed);
+				statistics.errors = errors.load(std::memory_order_relaxed);
+
+				for (std::size_t i = 0; i < histogram_size; i++)
+				{
+					statistics.time_histogram.at(i) = time_histogram.at(i).load(std::memory_order_relaxed);
+				}
+
+				std::lock_guard<std::mutex> lock{ error_reasons_mutex };
+				statistics.error_reasons = error_reasons;
+
+				return statistics;
+			}
+
+			void Counters::reset()
+			{
+				calls.store(0, std::memory_order_relaxed);
+				input_units.store(0, std::memory_order_relaxed);
+				output_units.store(0, std::memory_order_relaxed);
+				errors.store(0, std::memory_order_relaxed);
+
+				for (auto & x : time_histogram)
+					x.store(0, std::memory_order_relaxed);
+
+				std::lock_guard<std::mutex> lock{ error_reasons_mutex };
+				error_reasons.clear();
+			}
+
+			Counters & counters(std::size_t from, std::size_t to, bool is_base_encoder) noexcept
+			{
+				return registry().at((from * encoding_count + to) * 2 + (is_base_encoder ? 1 : 0));
+			}
+		}
+
+		std::vector<EncoderStatistics> snapshot()
+		{
+			std::vector<EncoderStatistics> statistics{};
+
+			for (std::size_t from = 0; from < encoding_count; from++)
+			{
+				for (std::size_t to = 0; to < encoding_count; to++)
+				{
+					for (bool is_base_encoder : { true, false })
+					{
+						if (auto encoder_statistics = helpers::counters(from, to, is_base_encoder).load(from, to, is_base_encoder); encoder_statistics.calls != 0)
+						{
+							statistics.push_back(std::move(encoder_statistics));
+						}
+					}
+				}
+			}
+
+			return statistics;
+		}
+
+		void reset()
+		{
+			for (auto & x : helpers::registry())
+				x.reset();
+		}
+	}
+}
@@ -0,0 +1,170 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include "BaseEncoders.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//Define ENCODING_INSTRUMENTATION (for the whole program) to collect statistics of every base encoder and every combined stage
+//Without it makeEncoder generates the same types as before and nothing is recorded
+
+namespace encoding
+{
+	namespace instrumentation
+	{
+		constexpr bool enabled =
+#ifdef ENCODING_INSTRUMENTATION
+			true;
+#else
+			false;
+#endif
+
+		constexpr std::size_t histogram_size = 32; // Bucket i counts calls which took [2^(i-1), 2^i) ns, the last one counts everything longer
+
+		struct EncoderStatistics
+		{
+			std::size_t from;
+			std::size_t to;
+			bool is_base_encoder;
+
+			std::uint64_t calls;
+			std::uint64_t input_units;
+			std::uint64_t output_units;
+			std::uint64_t errors;
+
+			std::array<std::uint64_t, histogram_size> time_histogram;
+			std::map<std::string, std::uint64_t> error_reasons; // ConvertionError::what() -> count
+		};
+
+		std::vector<EncoderStatistics> snapshot(); // Only encoders which were called
+		void reset();
+
+		namespace helpers
+		{
+			class Counters
+			{
+			public:
+				void recordCall(std::size_t input_units, std::size_t output_units, std::chrono::nanoseconds time) noexcept;
+				void recordError(std::size_t input_units, const char * reason);
+
+				EncoderStatistics load(std::size_t from, std::size_t to, bool is_base_encoder) const;
+				void reset();
+
+			private:
+				std::atomic<std::uint64_t> calls{};
+				std::atomic<std::uint64_t> input_units{};
+				std::atomic<std::uint64_t> output_units{};
+				std::atomic<std::uint64_t> errors{};
+				std::array<std::atomic<std::uint64_t>, histogram_size> time_histogram{};
+
+				mutable std::mutex error_reasons_mutex{};
+				std::map<std::string, std::uint64_t> error_reasons{};
+			};
+
+			Counters & counters(std::size_t from, std::size_t to, bool is_base_encoder) noexcept;
+		}
+
+		template<typename From, typename To, bool IS_BASE_ENCODER, typename F>
+		inline auto record(std::size_t input_units, F && convert)
+		{
+			static helpers::Counters & counters = helpers::counters(From::value, To::value, IS_BASE_ENCODER);
+
+			auto begin = std::chrono::steady_clock::now();
+			try
+			{
+				auto converted = convert();
+				counters.recordCall(input_units, std::size(converted), std::chrono::steady_clock::now() - begin);
+				return converted;
+			}
+			catch (const ConvertionError & error)
+			{
+				counters.recordError(input_units, error.what());
+				throw;
+			}
+		}
+
+		template<typename From, typename To, bool IS_BASE_ENCODER, typename Output, typename F>
+		inline void recordInto(std::size_t input_units, const Output & output, F && convert)
+		{
+			static helpers::Counters & counters = helpers::counters(From::value, To::value, IS_BASE_ENCODER);
+
+			auto begin = std::chrono::steady_clock::now();
+			try
+			{
+				convert();
+				counters.recordCall(input_units, std::size(output), std::chrono::steady_clock::now() - begin);
+			}
+			catch (const ConvertionError & error)
+			{
+				counters.recordError(input_units, error.what());
+				throw;
+			}
+		}
+
+		//Encoder E which records every convert call as the From -> To encoder
+		//It has the same constructors and convert overloads as E, so enabling the instrumentation doesn't change the API
+		template<typename From, typename To, typename E>
+		class InstrumentedEncoder : public E
+		{
+		public:
+			using typename E::input_type;
+			using typename E::output_type;
+
+			using E::E;
+
+			output_type convert(input_type text) const
+			{
+				return record<From, To, E::is_base_encoder::value>(std::size(text), [&] { return E::convert(text); });
+			}
+
+			template<typename T = E, std::enable_if_t<encoding::helpers::hasOutputConvert<T>::value, int> = 0>
+			void convert(input_type text, output_type & output)
+			{
+				recordInto<From, To, E::is_base_encoder::value>(std::size(text), output, [&] { E::convert(text, output); });
+			}
+
+			template<typename T = const E, std::enable_if_t<encoding::helpers::hasOutputConvert<T>::value, int> = 0>
+			void convert(input_type text, output_type & output) const
+			{
+				recordInto<From, To, E::is_base_encoder::value>(std::size(text), output, [&] { E::convert(text, output); });
+			}
+
+			template<typename T = E, std::enable_if_t<encoding::helpers::hasConvertOrBorrow<T>::value, int> = 0>
+			auto convertOrBorrow(input_type text) const
+			{
+				return record<From, To, E::is_base_encoder::value>(std::size(text), [&] { return E::convertOrBorrow(text); });
+			}
+
+			//In-place base encoders and combined encoders consume owned text
+			template<typename Text, std::enable_if_t<std::is_same_v<Text, encoding::helpers::owned_input_t<E>> &&
+				(encoding::helpers::isInPlaceEncoder<E>::value || !E::is_base_encoder::value), int> = 0>
+			auto convert(Text && text) const
+			{
+				if constexpr (encoding::helpers::isInPlaceEncoder<E>::value)
+				{
+					recordInto<From, To, E::is_base_encoder::value>(std::size(text), text, [&] { E::convert(std::move(text)); });
+				}
+				else
+				{
+					return record<From, To, E::is_base_encoder::value>(std::size(text), [&] { return encoding::helpers::consume(static_cast<const E &>(*this), std::move(text)); });
+				}
+			}
+		};
+	}
+
+	namespace helpers
+	{
+		template<typename From, typename To, typename E>
+		using instrumented_t = std::conditional_t<instrumentation::enabled, instrumentation::InstrumentedEncoder<From, To, E>, E>;
+	}
+}
+
+#endif // !INSTRUMENTATION_H
\ No newline at end of file
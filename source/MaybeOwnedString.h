@@ -0,0 +1,65 @@
+#ifndef MAYBE_OWNED_STRING_H
+#define MAYBE_OWNED_STRING_H
+
+#include <string>
+#include <string_view>
+#include <variant>
+
+namespace encoding
+{
+	//Result of a conversion which either borrows the input (the input did not need any change) or owns the converted text
+	//A borrowed result is valid only as long as the input
+	template<typename CharT>
+	class MaybeOwnedString
+	{
+	public:
+		using string_type = std::basic_string<CharT>;
+		using view_type = std::basic_string_view<CharT>;
+		using value_type = CharT;
+
+		MaybeOwnedString() = default;
+		MaybeOwnedString(view_type borrowed) : text{ borrowed } {}
+		MaybeOwnedString(string_type && owned) : text{ std::move(owned) } {}
+
+		bool isBorrowed() const noexcept
+		{
+			return std::holds_alternative<view_type>(text);
+		}
+
+		view_type view() const noexcept
+		{
+			if (auto borrowed = std::get_if<view_type>(&text))
+				return *borrowed;
+			else
+				return std::get<string_type>(text);
+		}
+
+		operator view_type() const noexcept
+		{
+			return view();
+		}
+
+		string_type str() const &
+		{
+			return string_type{ view() };
+		}
+
+		string_type str() &&
+		{
+			if (auto owned = std::get_if<string_type>(&text))
+				return std::move(*owned);
+			else
+				return string_type{ std::get<view_type>(text) };
+		}
+
+		std::size_t size() const noexcept
+		{
+			return view().size();
+		}
+
+	private:
+		std::variant<view_type, string_type> text{};
+	};
+}
+
+#endif // !MAYBE_OWNED_STRING_H
\ No newline at end of file
@@ -0,0 +1,347 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "Encoder.h"
+#include "CharacterBoundary.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <ios>
+#include <istream>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace encoding
+{
+	namespace helpers
+	{
+		//Bounded lock-free queue for exactly one producer thread and one consumer thread
+		//A thread which has to wait for the other side sleeps in wait(), the mutex is taken only when somebody waits
+		template<typename T, std::size_t CAPACITY>
+		class SPSCQueue
+		{
+		public:
+			bool tryPush(T & value) // Moves from value only on success
+			{
+				auto tail = this->tail.load(std::memory_order_relaxed);
+				auto next = (tail + 1) % buffer.size();
+
+				if (next == head.load(std::memory_order_acquire))
+				{
+					return false;
+				}
+
+				buffer.at(tail) = std::move(value);
+				this->tail.store(next); // seq_cst, like every access wake() and wait() rely on
+				wake();
+				return true;
+			}
+
+			bool tryPop(T & value)
+			{
+				auto head = this->head.load(std::memory_order_relaxed);
+
+				if (head == tail.load(std::memory_order_acquire))
+				{
+					return false;
+				}
+
+				value = std::move(buffer.at(head));
+				this->head.store((head + 1) % buffer.size());
+				wake();
+				return true;
+			}
+
+			bool empty() const noexcept
+			{
+				return head.load() == tail.load();
+			}
+
+			bool full() const noexcept
+			{
+				return (tail.load() + 1) % buffer.size() == head.load();
+			}
+
+			//Sleeps until ready() is true, ready() may depend only on this queue and on flags stored (seq_cst) before wake() is called
+			//The waiter is counted before ready() is checked and wake() checks the count after the change, so one of them sees the other
+			template<typename Predicate>
+			void wait(Predicate && ready)
+			{
+				std::unique_lock<std::mutex> lock{ mutex };
+				waiting.fetch_add(1);
+				condition.wait(lock, ready);
+				waiting.fetch_sub(1);
+			}
+
+			void wake()
+			{
+				if (waiting.load() != 0)
+				{
+					std::lock_guard<std::mutex> lock{ mutex };
+					condition.notify_all();
+				}
+			}
+
+		private:
+			std::array<T, CAPACITY + 1> buffer{};
+			alignas(64) std::atomic<std::size_t> head{};
+			alignas(64) std::atomic<std::size_t> tail{};
+
+			std::atomic<unsigned int> waiting{};
+			std::mutex mutex{};
+			std::condition_variable condition{};
+		};
+
+		//Length of the longest prefix of the text which contains only whole characters
+		template<typename T>
+		inline std::size_t completeCharactersLength(typename CharacterBoundary<T>::input_type text)
+		{
+			std::size_t lenght = 0;
+			while (lenght < text.size())
+			{
+				auto character_lenght = CharacterBoundary<T>::length(text.substr(lenght));
+				if (character_lenght > text.size() - lenght)
+				{
+					break;
+				}
+
+				lenght += character_lenght;
+			}
+
+			return lenght;
+		}
+	}
+
+	//Converts a stream chunk by chunk in three stages running at the same time:
+	//the reader thread fills the next chunk, the calling thread converts the current one and the writer thread writes the previous one
+	//Chunks are split on character boundaries, so the output is the same as convert() of the whole input
+	template<typename From, typename To, bool LOSSLESS = true>
+	class Pipeline
+	{
+	public:
+		using encoder_type = makeEncoder<From, To, LOSSLESS>;
+		using input_type = typename encoder_type::input_type;
+		using buffer_type = std::basic_string<typename input_type::value_type>;
+		using output_type = typename encoder_type::output_type;
+
+		explicit Pipeline(std::size_t chunk_size = 1 << 16) : chunk_size{ chunk_size }
+		{
+			if (chunk_size == 0)
+			{
+				throw std::invalid_argument{ "Pipeline chunk_size must not be 0" };
+			}
+		}
+
+		//reader(buffer_type & buffer, std::size_t chunk_size) appends at most chunk_size code units to the empty buffer, returns false after the end of the input
+		//writer(const output_type & converted) is called with the converted chunks in order
+		template<typename Reader, typename Writer, std::enable_if_t<std::is_invocable_r_v<bool, Reader &, buffer_type &, std::size_t> && std::is_invocable_v<Writer &, const output_type &>, int> = 0>
+		void run(Reader && reader, Writer && writer) const
+		{
+			helpers::SPSCQueue<buffer_type, queue_size> input_queue{};
+			helpers::SPSCQueue<buffer_type, queue_size + 1> free_buffers{}; // Read buffers go back to the reader and keep their capacity
+			helpers::SPSCQueue<output_type, queue_size> output_queue{};
+			helpers::SPSCQueue<output_type, queue_size + 1> free_outputs{}; // Written buffers go back to the converter
+
+			std::atomic<bool> reader_done{ false }, converter_done{ false }, stopped{ false };
+			std::exception_ptr reader_error{}, writer_error{};
+
+			auto stop = [&] {
+				stopped.store(true);
+				input_queue.wake();
+				output_queue.wake();
+			};
+
+			std::thread reader_thread{ [&] {
+				try
+				{
+					for (bool more = true; more && !stopped.load(std::memory_order_relaxed);)
+					{
+						buffer_type buffer{};
+						free_buffers.tryPop(buffer);
+						buffer.clear();
+
+						more = reader(buffer, chunk_size);
+						if (!buffer.empty() && !push(input_queue, buffer, stopped))
+						{
+							break;
+						}
+					}
+				}
+				catch (...)
+				{
+					reader_error = std::current_exception();
+					stop();
+				}
+
+				reader_done.store(true);
+				input_queue.wake();
+			} };
+
+			std::thread writer_thread{ [&] {
+				try
+				{
+					output_type converted{};
+					while (pop(output_queue, converted, converter_done, stopped))
+					{
+						writer(static_cast<const output_type &>(converted));
+						free_outputs.tryPush(converted);
+					}
+				}
+				catch (...)
+				{
+					writer_error = std::current_exception();
+					stop();
+				}
+			} };
+
+			std::exception_ptr converter_error{};
+			try
+			{
+				encoder_type encoder{};
+				buffer_type buffer{}, pending{}; // pending holds the start of a character split between chunks
+
+				auto convertAndPush = [&](input_type text) {
+					output_type converted{};
+					free_outputs.tryPop(converted);
+
+					helpers::convertInto(encoder, text, converted);
+					return push(output_queue, converted, stopped);
+				};
+
+				while (pop(input_queue, buffer, reader_done, stopped))
+				{
+					input_type text{ buffer };
+
+					if (!pending.empty()) // Only the split character is completed and converted on its own, the chunk is not copied
+					{
+						while (!text.empty() && CharacterBoundary<From>::length(pending) > pending.size())
+						{
+							pending += text.front();
+							text.remove_prefix(1);
+						}
+
+						if (CharacterBoundary<From>::length(pending) > pending.size())
+						{
+							free_buffers.tryPush(buffer);
+							continue;
+						}
+
+						if (!convertAndPush(pending))
+						{
+							break;
+						}
+
+						pending.clear();
+					}
+
+					auto lenght = helpers::completeCharactersLength<From>(text);
+					if (lenght != 0 && !convertAndPush(text.substr(0, lenght)))
+					{
+						break;
+					}
+
+					pending.assign(text.substr(lenght));
+					free_buffers.tryPush(buffer);
+				}
+
+				if (!pending.empty() && !stopped.load())
+				{
+					output_type converted = encoder.convert(input_type{ pending }); // Truncated character, the encoder reports it
+					push(output_queue, converted, stopped);
+				}
+			}
+			catch (...)
+			{
+				converter_error = std::current_exception();
+				stop();
+			}
+
+			converter_done.store(true);
+			output_queue.wake();
+
+			reader_thread.join();
+			writer_thread.join();
+
+			for (auto & error : { converter_error, reader_error, writer_error })
+			{
+				if (error)
+				{
+					std::rethrow_exception(error);
+				}
+			}
+		}
+
+		void run(std::basic_istream<typename buffer_type::value_type> & input, std::basic_ostream<typename output_type::value_type> & output) const
+		{
+			run(
+				[&input](buffer_type & buffer, std::size_t chunk_size) {
+					buffer.resize(chunk_size);
+					input.read(buffer.data(), static_cast<std::streamsize>(chunk_size));
+					buffer.resize(static_cast<std::size_t>(input.gcount()));
+
+					if (input.bad()) // Not the end of the input, the rest of it is lost
+					{
+						throw std::ios_base::failure{ "Input stream error" };
+					}
+
+					return static_cast<bool>(input);
+				},
+				[&output](const output_type & converted) {
+					if (!output.write(converted.data(), static_cast<std::streamsize>(converted.size())))
+					{
+						throw std::ios_base::failure{ "Output stream error" };
+					}
+				});
+		}
+
+	private:
+		static constexpr std::size_t queue_size = 2;
+
+		template<typename T, std::size_t CAPACITY>
+		static bool push(helpers::SPSCQueue<T, CAPACITY> & queue, T & value, const std::atomic<bool> & stopped)
+		{
+			while (!queue.tryPush(value))
+			{
+				if (stopped.load(std::memory_order_relaxed))
+				{
+					return false;
+				}
+
+				queue.wait([&] { return !queue.full() || stopped.load(); });
+			}
+
+			return true;
+		}
+
+		//Returns false when the producer is done and the queue is empty
+		template<typename T, std::size_t CAPACITY>
+		static bool pop(helpers::SPSCQueue<T, CAPACITY> & queue, T & value, const std::atomic<bool> & producer_done, const std::atomic<bool> & stopped)
+		{
+			while (!queue.tryPop(value))
+			{
+				if (stopped.load(std::memory_order_relaxed))
+				{
+					return false;
+				}
+
+				if (producer_done.load(std::memory_order_acquire))
+				{
+					return queue.tryPop(value);
+				}
+
+				queue.wait([&] { return !queue.empty() || producer_done.load() || stopped.load(); });
+			}
+
+			return true;
+		}
+
+		std::size_t chunk_size;
+	};
+}
+
+#endif // !PIPELINE_H
\ No newline at end of file
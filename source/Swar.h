@@ -0,0 +1,43 @@
+#ifndef SWAR_H
+#define SWAR_H
+
+#include <cstdint>
+#include <cstring>
+
+namespace encoding
+{
+	//Helpers testing 8 bytes at once, every byte of the word is tested in its own lane (SWAR)
+	//The masks have the highest bit of a byte set for the bytes which pass the test
+	namespace swar
+	{
+		constexpr std::uint64_t lanes_low = 0x0101010101010101u;
+		constexpr std::uint64_t lanes_high = 0x8080808080808080u;
+
+		inline std::uint64_t loadWord(const char * data) noexcept
+		{
+			std::uint64_t word;
+			std::memcpy(&word, data, sizeof(word));
+			return word;
+		}
+
+		inline std::uint64_t bytesEqual(std::uint64_t word, unsigned char byte) noexcept
+		{
+			auto x = word ^ (lanes_low * byte);
+			return ~(((x & ~lanes_high) + ~lanes_high) | x) & lanes_high;
+		}
+
+		inline std::uint64_t bytesBelow(std::uint64_t word, unsigned char byte) noexcept // byte <= 0x80
+		{
+			return ~(((word & ~lanes_high) + lanes_low * (0x80u - byte)) | word) & lanes_high;
+		}
+
+		inline std::uint64_t bytesInRange(std::uint64_t word, unsigned char first, unsigned char last) noexcept // Only for words without non ascii bytes
+		{
+			auto not_below = word + lanes_low * (0x80u - first);
+			auto above = word + lanes_low * (0x7Fu - last);
+			return not_below & ~above & lanes_high;
+		}
+	}
+}
+
+#endif // !SWAR_H
\ No newline at end of file
@@ -0,0 +1,55 @@
+#ifndef UTF8_VALIDATOR_H
+#define UTF8_VALIDATOR_H
+
+namespace encoding
+{
+	namespace helpers
+	{
+		//Strict UTF8 check fed byte by byte, rejects overlong forms, surrogates and characters above 0x10FFFF
+		class UTF8Validator
+		{
+		public:
+			void next(unsigned char byte) noexcept
+			{
+				if (pending == 0)
+				{
+					if (byte < 0x80)
+						return;
+
+					if (byte >= 0xC2 && byte <= 0xDF)
+						pending = 1;
+					else if (byte >= 0xE0 && byte <= 0xEF)
+						pending = 2;
+					else if (byte >= 0xF0 && byte <= 0xF4)
+						pending = 3;
+					else
+						valid = false;
+
+					//The second byte of these lead bytes has a narrower range (overlong forms, surrogates, > 0x10FFFF)
+					second_min = byte == 0xE0 ? 0xA0 : byte == 0xF0 ? 0x90 : 0x80;
+					second_max = byte == 0xED ? 0x9F : byte == 0xF4 ? 0x8F : 0xBF;
+					is_second = true;
+				}
+				else
+				{
+					if (byte < (is_second ? second_min : 0x80) || byte > (is_second ? second_max : 0xBF))
+						valid = false;
+
+					is_second = false;
+					--pending;
+				}
+			}
+
+			bool idle() const noexcept { return pending == 0; }
+			bool isValid() const noexcept { return valid && pending == 0; }
+
+		private:
+			unsigned int pending = 0;
+			unsigned char second_min = 0x80, second_max = 0xBF;
+			bool is_second = false;
+			bool valid = true;
+		};
+	}
+}
+
+#endif // !UTF8_VALIDATOR_H
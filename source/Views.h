@@ -0,0 +1,139 @@
+#ifndef VIEWS_H
+#define VIEWS_H
+
+#include "Encoder.h"
+#include "CharacterBoundary.h"
+
+#include <ranges>
+#include <iterator>
+#include <algorithm>
+
+//Requires C++20
+
+namespace encoding
+{
+	//Lazy view over the text converted from encoding From to encoding To
+	//Characters are converted one by one with makeEncoder<From, To, LOSSLESS>, only when the iterator reaches them,
+	//so a consumer which stops early does not pay for the rest of the text
+	template<typename From, typename To, bool LOSSLESS = true>
+	class TranscodeView : public std::ranges::view_interface<TranscodeView<From, To, LOSSLESS>>
+	{
+	public:
+		using encoder_type = makeEncoder<From, To, LOSSLESS>;
+		using input_type = typename encoder_type::input_type;
+		using buffer_type = typename encoder_type::output_type;
+
+		class iterator
+		{
+		public:
+			using value_type = typename buffer_type::value_type;
+			using difference_type = std::ptrdiff_t;
+			using iterator_concept = std::forward_iterator_tag;
+
+			iterator() = default;
+			explicit iterator(input_type text) : remaining{ text }
+			{
+				convertNextCharacter();
+			}
+
+			value_type operator*() const
+			{
+				return buffer[position];
+			}
+
+			iterator & operator++()
+			{
+				if (++position == buffer.size())
+				{
+					convertNextCharacter();
+				}
+
+				return *this;
+			}
+
+			iterator operator++(int)
+			{
+				auto copy = *this;
+				++*this;
+				return copy;
+			}
+
+			bool operator==(const iterator & other) const noexcept
+			{
+				return remaining.data() == other.remaining.data() && remaining.size() == other.remaining.size() && position == other.position;
+			}
+
+			bool operator==(std::default_sentinel_t) const noexcept
+			{
+				return position == buffer.size();
+			}
+
+		private:
+			void convertNextCharacter()
+			{
+				buffer.clear();
+				position = 0;
+
+				while (buffer.empty() && !remaining.empty())
+				{
+					auto lenght = std::min(CharacterBoundary<From>::length(remaining), remaining.size());
+
+					helpers::convertInto(encoder, remaining.substr(0, lenght), buffer);
+					remaining.remove_prefix(lenght);
+				}
+			}
+
+			encoder_type encoder{}; // Keeps the intermediate buffers, so converting a character does not allocate after the first ones
+			input_type remaining{};
+			buffer_type buffer{};
+			std::size_t position = 0;
+		};
+
+		TranscodeView() = default;
+		explicit TranscodeView(input_type text) : text{ text } {}
+
+		iterator begin() const
+		{
+			return iterator{ text };
+		}
+
+		std::default_sentinel_t end() const noexcept
+		{
+			return {};
+		}
+
+	private:
+		input_type text{};
+	};
+
+	namespace views
+	{
+		template<typename From, typename To, bool LOSSLESS = true>
+		struct TranscodeAdaptor
+		{
+			using view_type = TranscodeView<From, To, LOSSLESS>;
+
+			//Temporary strings are rejected, the view would outlive them
+			template<typename R, std::enable_if_t<std::is_lvalue_reference_v<R> || std::ranges::borrowed_range<R>, int> = 0>
+			view_type operator()(R && text) const
+			{
+				return view_type{ typename view_type::input_type{ text } };
+			}
+
+			template<typename R, std::enable_if_t<std::is_lvalue_reference_v<R> || std::ranges::borrowed_range<R>, int> = 0>
+			friend view_type operator|(R && text, const TranscodeAdaptor & adaptor)
+			{
+				return adaptor(std::forward<R>(text));
+			}
+		};
+
+		//e.g. text | encoding::views::transcode<encoding::UTF8, encoding::UTF16>
+		template<typename From, typename To, bool LOSSLESS = true>
+		inline constexpr TranscodeAdaptor<From, To, LOSSLESS> transcode{};
+	}
+}
+
+template<typename From, typename To, bool LOSSLESS>
+inline constexpr bool std::ranges::enable_borrowed_range<encoding::TranscodeView<From, To, LOSSLESS>> = true;
+
+#endif // !VIEWS_H
\ No newline at end of file